@@ -0,0 +1,69 @@
+/*
+  Name:    faultCapture.ino
+  Created: 19-10-2026
+  Author:  SolidGeek
+  Description:  This example polls a VESC at 20 Hz and prints the telemetry from before and after
+                a fault. The VESC is polled at 200 Hz for half a second after the fault.
+*/
+
+#include <VescUart.h>
+#include <VescPlanner.h>
+#include <VescFaultCapture.h>
+
+/** Initiate VescUart class */
+VescUart UART;
+
+/** Poll planner for the 115200 baud link */
+VescPlanner planner(UART, 115200);
+
+/** Fault capture of the local controller */
+VescFaultCapture capture(0);
+
+void printCapture(VescFaultCapture & capture, void * context) {
+
+  Serial.print("Fault ");
+  Serial.println(capture.fault());
+
+  for (uint16_t i = 0; i < capture.length(); i++) {
+    Serial.print((int32_t)(capture.sample(i).rxTime_us - capture.sample(capture.triggerIndex()).rxTime_us));
+    Serial.print(" us: ");
+    Serial.print(capture.sample(i).rpm);
+    Serial.print(" ERPM, ");
+    Serial.print(capture.sample(i).avgMotorCurrent);
+    Serial.println(" mA");
+  }
+}
+
+/** Every decoded reply goes into the capture */
+void addValues(uint8_t canId, void * context) {
+  if (canId == capture.canId()) {
+    capture.addSample(UART.dataRaw);
+  }
+}
+
+void setup() {
+
+  /** Setup Serial port to display data */
+  Serial.begin(115200);
+
+  /** Setup UART port (Serial1 on Atmega32u4) */
+  Serial1.begin(115200);
+  
+  while (!Serial) {;}
+
+  /** Define which ports to use as UART */
+  UART.setSerialPort(&Serial1);
+
+  planner.addController(0, 20, VALUES_MASK_RPM | VALUES_MASK_MOTOR_CURRENT | VALUES_MASK_FAULT);
+  planner.plan();
+
+  UART.setValuesHandler(addValues, NULL);
+  capture.setCallback(printCapture, NULL);
+  capture.setBurst(&planner, 200);
+}
+
+void loop() {
+
+  planner.poll();
+  UART.update();
+}
@@ -0,0 +1,70 @@
+/*
+  Name:    firmwareUpload.ino
+  Created: 19-10-2026
+  Author:  SolidGeek
+  Description:  This example shows how to update the firmware of the VESC from a file on an SD card.
+                The file is streamed in chunks, so it does not have to fit in RAM.
+*/
+
+#include <SPI.h>
+#include <SD.h>
+#include <VescUart.h>
+#include <VescUploader.h>
+
+/** Initiate VescUart class */
+VescUart UART;
+
+/** Initiate VescUploader class */
+VescUploader uploader(UART);
+
+void printProgress(uint32_t written, uint32_t total) {
+  Serial.print(written);
+  Serial.print(" / ");
+  Serial.println(total);
+}
+
+void setup() {
+
+  /** Setup Serial port to display data */
+  Serial.begin(115200);
+
+  /** Setup UART port (Serial1 on Atmega32u4) */
+  Serial1.begin(115200);
+  
+  while (!Serial) {;}
+
+  /** Define which ports to use as UART */
+  UART.setSerialPort(&Serial1);
+
+  if (!SD.begin()) {
+    Serial.println("No SD card");
+    return;
+  }
+
+  File image = SD.open("VESC.BIN");
+  if (!image) {
+    Serial.println("VESC.BIN not found");
+    return;
+  }
+
+  uploader.setProgressCallback(printProgress);
+
+  /** Use uploadAllCan() to update every controller on the CAN bus */
+  if ( uploader.upload(image, image.size()) ) {
+    Serial.print(uploader.bytesPerSecond());
+    Serial.print(" bytes/s, compression ratio ");
+    Serial.println(uploader.compressionRatio());
+
+    /** The bootloader installs the new firmware and reboots the VESC */
+    uploader.jumpToBootloader();
+  }
+  else
+  {
+    Serial.println("Upload failed");
+  }
+
+  image.close();
+}
+
+void loop() {
+}
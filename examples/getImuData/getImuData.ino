@@ -0,0 +1,46 @@
+/*
+  Name:    getImuData.ino
+  Created: 19-10-2026
+  Author:  SolidGeek
+  Description:  This example shows how to stream the IMU data of the VESC without blocking.
+                Only the fields selected by the mask are requested and sent back.
+*/
+
+#include <VescUart.h>
+
+/** Initiate VescUart class */
+VescUart UART;
+
+unsigned long lastRequest = 0;
+
+void setup() {
+
+  /** Setup Serial port to display data */
+  Serial.begin(115200);
+
+  /** Setup UART port (Serial1 on Atmega32u4) */
+  Serial1.begin(115200);
+  
+  while (!Serial) {;}
+
+  /** Define which ports to use as UART */
+  UART.setSerialPort(&Serial1);
+}
+
+void loop() {
+
+  /** Request roll, pitch and yaw every 10 ms, without waiting for the reply */
+  if (millis() - lastRequest >= 10) {
+    lastRequest = millis();
+    UART.requestImuData(IMU_MASK_RPY);
+  }
+
+  /** Decode the replies as they arrive */
+  if ( UART.update() > 0 ) {
+    Serial.print(UART.imu.roll);
+    Serial.print(" ");
+    Serial.print(UART.imu.pitch);
+    Serial.print(" ");
+    Serial.println(UART.imu.yaw);
+  }
+}
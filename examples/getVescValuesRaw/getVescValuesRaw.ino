@@ -0,0 +1,45 @@
+/*
+  Name:    getVescValuesRaw.ino
+  Created: 19-10-2026
+  Author:  SolidGeek
+  Description:  This example shows how to read the telemetry as scaled integers (mA, mV, 0.1 degC),
+                which avoids software float math on 8-bit boards like the Arduino Micro (Atmega32u4).
+*/
+
+#include <VescUart.h>
+
+/** Initiate VescUart class */
+VescUart UART;
+
+void setup() {
+
+  /** Setup Serial port to display data */
+  Serial.begin(9600);
+
+  /** Setup UART port (Serial1 on Atmega32u4) */
+  Serial1.begin(19200);
+  
+  while (!Serial) {;}
+
+  /** Define which ports to use as UART */
+  UART.setSerialPort(&Serial1);
+}
+
+void loop() {
+  
+  /** Call the function getVescValuesRaw() to acquire data from VESC without float conversion */
+  if ( UART.getVescValuesRaw() ) {
+
+    Serial.println(UART.dataRaw.rpm);
+    Serial.println(UART.dataRaw.inpVoltage);      // mV
+    Serial.println(UART.dataRaw.avgMotorCurrent); // mA
+    Serial.println(UART.dataRaw.tempMosfet);      // 0.1 degC
+
+  }
+  else
+  {
+    Serial.println("Failed to get data!");
+  }
+
+  delay(50);
+}
@@ -0,0 +1,59 @@
+/*
+  Name:    pollPlanner.ino
+  Created: 19-10-2026
+  Author:  SolidGeek
+  Description:  This example polls three controllers on one UART, each at its own rate and with
+                only the fields it needs. The planner tells if the rates fit the link.
+*/
+
+#include <VescUart.h>
+#include <VescPlanner.h>
+
+/** Initiate VescUart class */
+VescUart UART;
+
+/** Poll planner for the 115200 baud link */
+VescPlanner planner(UART, 115200);
+
+/** Called by update() for every reply, several replies can arrive between two calls */
+void printValues(uint8_t canId, void * context) {
+  UART.convertRawValues();
+  Serial.print(canId);
+  Serial.print(": ");
+  Serial.println(UART.data.rpm);
+}
+
+void setup() {
+
+  /** Setup Serial port to display data */
+  Serial.begin(115200);
+
+  /** Setup UART port (Serial1 on Atmega32u4) */
+  Serial1.begin(115200);
+  
+  while (!Serial) {;}
+
+  /** Define which ports to use as UART */
+  UART.setSerialPort(&Serial1);
+
+  /** The local controller at 50 Hz, two controllers on CAN at 20 and 2 Hz */
+  planner.addController(0, 50, VALUES_MASK_RPM | VALUES_MASK_MOTOR_CURRENT | VALUES_MASK_DUTY | VALUES_MASK_CONTROLLER_ID);
+  planner.addController(1, 20, VALUES_MASK_RPM | VALUES_MASK_MOTOR_CURRENT | VALUES_MASK_CONTROLLER_ID);
+  planner.addController(2, 2, VALUES_MASK_INPUT_VOLTAGE | VALUES_MASK_TEMP_MOSFET | VALUES_MASK_CONTROLLER_ID);
+
+  UART.setValuesHandler(printValues, NULL);
+
+  if (!planner.plan()) {
+    Serial.print("Rates do not fit the link, running at ");
+    Serial.print(planner.scale * 100);
+    Serial.println("%");
+  }
+}
+
+void loop() {
+
+  planner.poll();
+
+  /** Decode the replies as they arrive */
+  UART.update();
+}
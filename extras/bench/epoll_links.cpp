@@ -0,0 +1,249 @@
+// Scaling benchmark of VescEventLoop: 1 to 64 links over pty pairs, each polled with
+// COMM_GET_VALUES every period_ms and answered by a simulated VESC. The simulators run in
+// a child process, so the CPU time reported is that of the event loop alone.
+//
+// Build and run from the repository root (Linux only):
+//
+//   g++ -O2 -std=c++11 -Isrc/host -Isrc extras/bench/epoll_links.cpp src/*.cpp src/host/*.cpp -o epoll_links
+//   ./epoll_links [period_ms] [seconds]
+
+#include <VescEventLoop.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define MAX_LINKS VESCEVENTLOOP_MAX_LINKS
+
+/* Simulated VESC on the master side of a pty */
+
+struct simulator {
+	int fd;
+	uint8_t rx[512];
+	int rxLen;
+};
+
+static void sendFrame(int fd, const uint8_t * payload, int len) {
+	uint8_t frame[300];
+	int i = 0;
+	frame[i++] = 2;
+	frame[i++] = len;
+	memcpy(frame + i, payload, len);
+	i += len;
+	uint16_t crc = crc16((unsigned char *)payload, len);
+	frame[i++] = crc >> 8;
+	frame[i++] = crc & 0xFF;
+	frame[i++] = 3;
+	if (write(fd, frame, i) != i) {
+		// The pty buffer is far larger than the replies in flight
+	}
+}
+
+static void reply(simulator * sim, const uint8_t * request) {
+
+	uint8_t b[256];
+	int32_t i = 0;
+
+	switch (request[0]) {
+		case COMM_FW_VERSION:
+			b[i++] = COMM_FW_VERSION;
+			b[i++] = 6;
+			b[i++] = 2;
+			memcpy(b + i, "SIM", 4);
+			i += 4;
+			memset(b + i, 0, 12 + 3);
+			i += 12 + 3;
+			break;
+
+		case COMM_GET_VALUES:
+			b[i++] = COMM_GET_VALUES;
+			buffer_append_float16(b, 35.5, 10, &i);
+			buffer_append_float16(b, 40.1, 10, &i);
+			buffer_append_float32(b, 12.34, 100, &i);
+			buffer_append_float32(b, 5.67, 100, &i);
+			buffer_append_float32(b, -1.5, 100, &i);
+			buffer_append_float32(b, 12.0, 100, &i);
+			buffer_append_float16(b, 0.456, 1000, &i);
+			buffer_append_float32(b, 12345, 1, &i);
+			buffer_append_float16(b, 48.3, 10, &i);
+			buffer_append_float32(b, 1.2345, 10000, &i);
+			buffer_append_float32(b, 0.5, 10000, &i);
+			buffer_append_float32(b, 55.5, 10000, &i);
+			buffer_append_float32(b, 2.5, 10000, &i);
+			buffer_append_int32(b, 100000, &i);
+			buffer_append_int32(b, 200000, &i);
+			b[i++] = 0;
+			buffer_append_float32(b, 180.5, 1e6, &i);
+			b[i++] = 0;
+			buffer_append_float16(b, 36, 10, &i);
+			buffer_append_float16(b, 37, 10, &i);
+			buffer_append_float16(b, 38, 10, &i);
+			buffer_append_float32(b, 3.25, 1000, &i);
+			buffer_append_float32(b, 20.5, 1000, &i);
+			b[i++] = 2;
+			break;
+
+		default:
+			return;
+	}
+	sendFrame(sim->fd, b, i);
+}
+
+static void simulate(simulator * sims, int links) {
+
+	int ep = epoll_create1(0);
+	for (int l = 0; l < links; l++) {
+		struct epoll_event event;
+		event.events = EPOLLIN;
+		event.data.ptr = &sims[l];
+		epoll_ctl(ep, EPOLL_CTL_ADD, sims[l].fd, &event);
+	}
+
+	struct epoll_event events[MAX_LINKS];
+	for (;;) {
+		int n = epoll_wait(ep, events, MAX_LINKS, -1);
+		for (int e = 0; e < n; e++) {
+			simulator * sim = (simulator *)events[e].data.ptr;
+			ssize_t r = read(sim->fd, sim->rx + sim->rxLen, sizeof(sim->rx) - sim->rxLen);
+			if (r <= 0) {
+				continue;
+			}
+			sim->rxLen += r;
+
+			// Short frames only: [2][len][payload][crc16][3]
+			int pos = 0;
+			while (sim->rxLen - pos >= 2) {
+				if (sim->rx[pos] != 2) {
+					pos++;
+					continue;
+				}
+				int len = sim->rx[pos + 1];
+				if (sim->rxLen - pos < len + 5) {
+					break;
+				}
+				reply(sim, sim->rx + pos + 2);
+				pos += len + 5;
+			}
+			memmove(sim->rx, sim->rx + pos, sim->rxLen - pos);
+			sim->rxLen -= pos;
+		}
+	}
+}
+
+/* Event loop side */
+
+static uint32_t replies = 0;
+
+static void onUpdate(VescUart &, void *) {
+	replies++;
+}
+
+static int openPty(int * master) {
+
+	*master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0) {
+		return -1;
+	}
+
+	int slave = open(ptsname(*master), O_RDWR | O_NOCTTY);
+	if (slave < 0) {
+		return -1;
+	}
+
+	// Binary frames, no line discipline on either side
+	struct termios tty;
+	tcgetattr(slave, &tty);
+	cfmakeraw(&tty);
+	tcsetattr(slave, TCSANOW, &tty);
+	return slave;
+}
+
+static double cpuSeconds(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void bench(int links, uint32_t period_ms, uint32_t seconds) {
+
+	static simulator sims[MAX_LINKS];
+	static VescUart * vescs[MAX_LINKS];
+	static FdStream * streams[MAX_LINKS];
+	int slaves[MAX_LINKS];
+
+	for (int l = 0; l < links; l++) {
+		slaves[l] = openPty(&sims[l].fd);
+		sims[l].rxLen = 0;
+		if (slaves[l] < 0) {
+			perror("pty");
+			exit(1);
+		}
+	}
+
+	pid_t child = fork();
+	if (child == 0) {
+		for (int l = 0; l < links; l++) {
+			close(slaves[l]);
+		}
+		simulate(sims, links);
+		_exit(0);
+	}
+	for (int l = 0; l < links; l++) {
+		close(sims[l].fd);
+	}
+
+	VescEventLoop loop;
+	for (int l = 0; l < links; l++) {
+		vescs[l] = new VescUart();
+		streams[l] = new FdStream(slaves[l]);
+		loop.addLink(*vescs[l], *streams[l], period_ms, NULL, onUpdate, NULL);
+	}
+
+	// Warm up, so the firmware version of every link is known
+	uint32_t start = millis();
+	while (millis() - start < 200) {
+		loop.runOnce(-1);
+	}
+
+	replies = 0;
+	double cpu = cpuSeconds();
+	start = millis();
+	while (millis() - start < seconds * 1000) {
+		loop.runOnce(-1);
+	}
+	double elapsed = (millis() - start) / 1000.0;
+	cpu = cpuSeconds() - cpu;
+
+	uint32_t expected = (uint32_t)(links * elapsed * 1000 / period_ms);
+	printf("%5d %10.0f %8.1f%% %8.2f%% %10.1f %9.1f%%\n", links, replies / elapsed, 100 * cpu / elapsed,
+		100 * cpu / elapsed / links, 1e6 * cpu / (replies ? replies : 1), 100.0 * replies / (expected ? expected : 1));
+
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	for (int l = 0; l < links; l++) {
+		loop.removeLink(*vescs[l]);
+		delete streams[l];
+		delete vescs[l];
+		close(slaves[l]);
+	}
+}
+
+int main(int argc, char ** argv) {
+
+	uint32_t period_ms = argc > 1 ? atoi(argv[1]) : 10;
+	uint32_t seconds = argc > 2 ? atoi(argv[2]) : 3;
+
+	printf("COMM_GET_VALUES every %u ms per link, %u s per run\n", period_ms, seconds);
+	printf("links  replies/s      CPU CPU/link  us/reply  answered\n");
+
+	for (int links = 1; links <= MAX_LINKS; links *= 2) {
+		bench(links, period_ms, seconds);
+	}
+	return 0;
+}
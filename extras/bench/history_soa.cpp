@@ -0,0 +1,132 @@
+// Window queries on VescHistory, which keeps a ring per field (structure of arrays), against
+// a ring of whole dataPackage samples (array of structs) with plain loops. Both hold the same
+// samples; the table shows the time of one query and of one append.
+//
+// Build and run from the repository root (Linux only):
+//
+//   g++ -O2 -std=c++11 -Isrc/host -Isrc extras/bench/history_soa.cpp src/*.cpp src/host/*.cpp -o history_soa
+//   ./history_soa [capacity]
+
+#include <VescHistory.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef decltype(VescUart::data) dataPackage;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The array of structs baseline */
+
+struct aosHistory {
+	dataPackage * samples;
+	uint32_t mask;
+	uint32_t head;
+	uint32_t count;
+};
+
+static void aosAdd(aosHistory & h, const dataPackage & values) {
+	h.samples[h.head] = values;
+	h.head = (h.head + 1) & h.mask;
+	if (h.count <= h.mask) {
+		h.count++;
+	}
+}
+
+static float aosMean(aosHistory & h, uint32_t n) {
+	float sum = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		sum += h.samples[(h.head - 1 - i) & h.mask].rpm;
+	}
+	return sum / n;
+}
+
+static float aosMax(aosHistory & h, uint32_t n) {
+	float result = h.samples[(h.head - 1) & h.mask].rpm;
+	for (uint32_t i = 1; i < n; i++) {
+		float v = h.samples[(h.head - 1 - i) & h.mask].rpm;
+		result = v > result ? v : result;
+	}
+	return result;
+}
+
+static volatile float sink;
+
+int main(int argc, char ** argv) {
+
+	uint32_t capacity = argc > 1 ? atoi(argv[1]) : 65536;
+	VescHistory soa(capacity);
+	capacity = soa.capacity();
+
+	aosHistory aos;
+	aos.samples = new dataPackage[capacity];
+	aos.mask = capacity - 1;
+	aos.head = 0;
+	aos.count = 0;
+
+	dataPackage values;
+	memset(&values, 0, sizeof(values));
+	srand(1);
+
+	// Fill both twice over, so the windows wrap around the end of the rings
+	uint64_t soaAdd = 0, aosAdd_ns = 0;
+	for (uint32_t i = 0; i < 2 * capacity + capacity / 3; i++) {
+		values.rpm = 10000 + rand() % 2000;
+		values.avgMotorCurrent = (rand() % 4000) / 100.0f;
+		values.rxTime_us = i * 10000;
+
+		uint64_t start = now_ns();
+		soa.addSample(values);
+		soaAdd += now_ns() - start;
+
+		start = now_ns();
+		aosAdd(aos, values);
+		aosAdd_ns += now_ns() - start;
+	}
+	uint32_t adds = 2 * capacity + capacity / 3;
+
+	printf("capacity %u, sizeof(dataPackage) %u, append: SoA %.1f ns, AoS %.1f ns\n\n", capacity,
+		(unsigned)sizeof(dataPackage), (double)soaAdd / adds, (double)aosAdd_ns / adds);
+	printf("%8s %12s %12s %12s %12s %12s %8s\n", "window", "SoA mean", "AoS mean", "SoA max", "AoS max", "SoA p95", "check");
+
+	for (uint32_t n = 64; n <= capacity; n *= 4) {
+		int repeat = (int)(4000000 / n) + 1;
+		bool same = true;
+
+		uint64_t start = now_ns();
+		for (int r = 0; r < repeat; r++) sink = soa.mean(VescHistory::HISTORY_RPM, n);
+		double soaMean = (double)(now_ns() - start) / repeat;
+		float a = sink;
+
+		start = now_ns();
+		for (int r = 0; r < repeat; r++) sink = aosMean(aos, n);
+		double aosMean_ns = (double)(now_ns() - start) / repeat;
+		same = same && fabsf(a - sink) <= 1e-3f * fabsf(sink);
+
+		start = now_ns();
+		for (int r = 0; r < repeat; r++) sink = soa.maximum(VescHistory::HISTORY_RPM, n);
+		double soaMax = (double)(now_ns() - start) / repeat;
+		a = sink;
+
+		start = now_ns();
+		for (int r = 0; r < repeat; r++) sink = aosMax(aos, n);
+		double aosMax_ns = (double)(now_ns() - start) / repeat;
+		same = same && a == sink;
+
+		int pRepeat = repeat / 8 + 1;
+		start = now_ns();
+		for (int r = 0; r < pRepeat; r++) sink = soa.percentile(VescHistory::HISTORY_RPM, n, 0.95f);
+		double soaP95 = (double)(now_ns() - start) / pRepeat;
+
+		printf("%8u %9.0f ns %9.0f ns %9.0f ns %9.0f ns %9.0f ns %8s\n", n, soaMean, aosMean_ns, soaMax, aosMax_ns, soaP95, same ? "ok" : "MISMATCH");
+	}
+
+	delete[] aos.samples;
+	return 0;
+}
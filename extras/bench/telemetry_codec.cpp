@@ -0,0 +1,154 @@
+// Compression ratio and cost of VescTelemetryEncoder on a synthetic ride: an rpm ramp with
+// noise, motor and input current following it, slowly rising temperatures and the ever
+// growing counters. Every sample is decoded again and checked against the input.
+//
+// Build and run from the repository root (Linux only):
+//
+//   g++ -O2 -std=c++11 -Isrc/host -Isrc extras/bench/telemetry_codec.cpp src/*.cpp src/host/*.cpp -o telemetry_codec
+//   ./telemetry_codec [samples]
+
+#include <VescTelemetry.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef decltype(VescUart::dataRaw) rawDataPackage;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int noise(int amplitude) {
+	return rand() % (2 * amplitude + 1) - amplitude;
+}
+
+static void makeStream(rawDataPackage * samples, int count, uint32_t mask) {
+
+	memset(samples, 0, sizeof(rawDataPackage) * count);
+	srand(1);
+
+	int32_t ah = 0, wh = 0, tach = 0;
+	for (int i = 0; i < count; i++) {
+		rawDataPackage & s = samples[i];
+
+		// Accelerate for 4 s, cruise for 4 s, brake for 2 s, at 50 Hz
+		int phase = i % 500;
+		int32_t rpm = phase < 200 ? phase * 150 : (phase < 400 ? 30000 : 30000 - (phase - 400) * 300);
+		int32_t current = phase < 200 ? 40000 : (phase < 400 ? 8000 : -25000);
+
+		s.rpm = rpm + noise(20);
+		s.avgMotorCurrent = (current + noise(300)) / 10 * 10;
+		s.avgInputCurrent = (current / 2 + noise(200)) / 10 * 10;
+		s.avgId = noise(50) * 10;
+		s.avgIq = s.avgMotorCurrent;
+		s.avgVd = noise(100);
+		s.avgVq = rpm / 3 + noise(100);
+		s.dutyCycleNow = rpm / 33;
+		s.inpVoltage = (480 - current / 10000 + noise(1)) * 100;
+		s.tempMosfet = 300 + i / 200;
+		s.tempMotor = 350 + i / 150;
+		s.tempMosfet1 = s.tempMosfet + noise(1);
+		s.tempMosfet2 = s.tempMosfet + noise(1);
+		s.tempMosfet3 = s.tempMosfet + noise(1);
+
+		ah += current > 0 ? current / 3600 : 0;
+		wh += current > 0 ? current * 48 / 3600 : 0;
+		tach += rpm / 3000;
+		s.ampHours = ah / 100;
+		s.wattHours = wh / 100;
+		s.tachometer = tach;
+		s.tachometerAbs = tach;
+		s.pidPos = (tach * 60000) % 360000000;
+		s.id = 1;
+		s.fields = mask;
+	}
+}
+
+static bool sameValues(const rawDataPackage & a, const rawDataPackage & b) {
+
+	// Only the fields in the mask are carried
+	uint32_t m = b.fields;
+	return a.fields == b.fields
+		&& (!(m & VALUES_MASK_RPM) || a.rpm == b.rpm)
+		&& (!(m & VALUES_MASK_MOTOR_CURRENT) || a.avgMotorCurrent == b.avgMotorCurrent)
+		&& (!(m & VALUES_MASK_INPUT_CURRENT) || a.avgInputCurrent == b.avgInputCurrent)
+		&& (!(m & VALUES_MASK_VD_VQ) || a.avgVq == b.avgVq)
+		&& (!(m & VALUES_MASK_DUTY) || a.dutyCycleNow == b.dutyCycleNow)
+		&& (!(m & VALUES_MASK_INPUT_VOLTAGE) || a.inpVoltage == b.inpVoltage)
+		&& (!(m & VALUES_MASK_TEMP_MOSFET) || a.tempMosfet == b.tempMosfet)
+		&& (!(m & VALUES_MASK_TEMP_MOTOR) || a.tempMotor == b.tempMotor)
+		&& (!(m & VALUES_MASK_TEMP_MOSFETS) || a.tempMosfet3 == b.tempMosfet3)
+		&& (!(m & VALUES_MASK_TACHOMETER) || a.tachometer == b.tachometer)
+		&& (!(m & VALUES_MASK_WATT_HOURS) || a.wattHours == b.wattHours);
+}
+
+static void run(const char * name, rawDataPackage * samples, int count) {
+
+	static rawDataPackage output[VESCTELEMETRY_BUFFER_SIZE];
+	VescTelemetryEncoder encoder;
+	VescTelemetryDecoder decoder;
+	uint64_t encodeNs = 0, decodeNs = 0;
+	int decoded = 0, mismatches = 0;
+
+	for (int i = 0; i <= count; i++) {
+		uint64_t start = now_ns();
+		int len = i < count ? encoder.encode(samples[i], i * 20) : 0;
+		encodeNs += now_ns() - start;
+
+		// Decode each full buffer, then start the next one with a keyframe
+		if (len == 0) {
+			start = now_ns();
+			decoder.begin(encoder.data(), encoder.length());
+			int n = 0;
+			while (decoder.next()) {
+				output[n++] = decoder.values;
+			}
+			decodeNs += now_ns() - start;
+
+			for (int j = 0; j < n; j++) {
+				if (decoded + j >= count || !sameValues(output[j], samples[decoded + j])) {
+					mismatches++;
+				}
+			}
+			decoded += n;
+			encoder.reset();
+			if (i < count) {
+				encoder.encode(samples[i], i * 20);
+			}
+		}
+	}
+
+	// The wire payload of a full reply: the packet id, then the fields
+	int payload = 1 + VescUart::valuesSize(samples[0].fields);
+	float perSample = (float)encoder.bytes / encoder.samples;
+
+	printf("%-10s %8.2f %11.1fx %13.1fx %10.0f %10.0f  %s\n", name, perSample,
+		payload / perSample, sizeof(VescUart::data) / perSample,
+		(double)encodeNs / count, (double)decodeNs / count,
+		decoded == count && mismatches == 0 && decoder.errors == 0 ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char ** argv) {
+
+	int count = argc > 1 ? atoi(argv[1]) : 100000;
+	rawDataPackage * samples = new rawDataPackage[count];
+
+	// Keep the buffer size at its default; every buffer starts with a keyframe
+	printf("%d samples at 50 Hz, %d byte buffer, keyframe every %d samples\n\n", count, VESCTELEMETRY_BUFFER_SIZE, VESCTELEMETRY_KEYFRAME_INTERVAL);
+	printf("%-10s %8s %12s %14s %10s %10s\n", "fields", "B/sample", "vs payload", "vs dataPackage", "enc ns", "dec ns");
+
+	makeStream(samples, count, VALUES_MASK_ALL);
+	run("all", samples, count);
+
+	makeStream(samples, count, VALUES_MASK_RPM | VALUES_MASK_MOTOR_CURRENT | VALUES_MASK_DUTY | VALUES_MASK_INPUT_VOLTAGE);
+	run("drive", samples, count);
+
+	makeStream(samples, count, VALUES_MASK_TEMP_MOSFET | VALUES_MASK_TEMP_MOTOR | VALUES_MASK_INPUT_VOLTAGE);
+	run("slow", samples, count);
+
+	delete[] samples;
+	return 0;
+}
@@ -0,0 +1,300 @@
+// Throughput of VescUploader over a pty pair against a simulated VESC that delays, drops or
+// holds back its acknowledgements. The simulator runs in a child process, writes the chunks
+// into its own flash and checks the CRC in the header, so every run also verifies the image.
+// Each case runs with acknowledgements that carry the offset (firmware 5.x and newer, several
+// chunks in flight) and without (older firmware, one chunk in flight). Without the offset a
+// late acknowledgement is taken for the next write, which is why those rows resend less.
+//
+// Build and run from the repository root (Linux only). The shorter acknowledgement timeout
+// keeps the runs with dropped acknowledgements short:
+//
+//   g++ -O2 -std=c++11 -DVESCUPLOADER_ACK_TIMEOUT=100 -Isrc/host -Isrc extras/bench/uploader.cpp src/*.cpp src/host/*.cpp -o uploader
+//   ./uploader [image_kB]
+
+#include <VescUploader.h>
+#include <FdStream.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define FLASH_SIZE (1024 * 1024)
+#define MAX_ACKS 64
+
+struct scenario {
+	uint32_t delay_ms;		// Every acknowledgement
+	float dropped;			// Fraction never sent
+	float late;				// Fraction sent after the acknowledgement timeout
+};
+
+/* Simulated VESC on the master side of the pty */
+
+struct pendingAck {
+	uint32_t due;
+	int len;
+	uint8_t payload[8];
+};
+
+struct simulator {
+	int fd;
+	bool offsets;
+	scenario link;
+	uint8_t rx[2048];
+	int rxLen;
+	uint8_t * flash;
+	pendingAck acks[MAX_ACKS];
+	int ackCount;
+};
+
+static void sendFrame(int fd, const uint8_t * payload, int len) {
+	uint8_t frame[16];
+	int i = 0;
+	frame[i++] = 2;
+	frame[i++] = len;
+	memcpy(frame + i, payload, len);
+	i += len;
+	uint16_t crc = crc16((unsigned char *)payload, len);
+	frame[i++] = crc >> 8;
+	frame[i++] = crc & 0xFF;
+	frame[i++] = 3;
+	if (write(fd, frame, i) != i) {
+		// The pty buffer is far larger than the acknowledgements in flight
+	}
+}
+
+static void acknowledge(simulator * sim, const uint8_t * payload, int len) {
+
+	float r = (float)rand() / RAND_MAX;
+	if (r < sim->link.dropped || sim->ackCount == MAX_ACKS) {
+		return;
+	}
+
+	pendingAck * ack = &sim->acks[sim->ackCount++];
+	ack->due = millis() + (r < sim->link.dropped + sim->link.late ? VESCUPLOADER_ACK_TIMEOUT * 3 / 2 : sim->link.delay_ms);
+	ack->len = len;
+	memcpy(ack->payload, payload, len);
+}
+
+static void handle(simulator * sim, const uint8_t * request, int len) {
+
+	uint8_t b[8];
+	int32_t i = 0;
+	int32_t index = 1;
+
+	switch (request[0]) {
+		case COMM_ERASE_NEW_APP:
+			memset(sim->flash, 0xFF, FLASH_SIZE);
+			b[i++] = COMM_ERASE_NEW_APP;
+			b[i++] = 1;
+			sendFrame(sim->fd, b, i);
+			return;
+
+		case COMM_WRITE_NEW_APP_DATA: {
+			uint32_t offset = buffer_get_uint32(request, &index);
+			int dataLen = len - index;
+			bool ok = offset + dataLen <= FLASH_SIZE;
+			if (ok) {
+				memcpy(sim->flash + offset, request + index, dataLen);
+			}
+
+			// The header is written last: check the image against its size and CRC
+			if (ok && offset == 0) {
+				int32_t h = 0;
+				uint32_t size = buffer_get_uint32(sim->flash, &h);
+				uint16_t crc = buffer_get_uint16(sim->flash, &h);
+				ok = size + 6 <= FLASH_SIZE && crc16(sim->flash + 6, size) == crc;
+			}
+
+			b[i++] = COMM_WRITE_NEW_APP_DATA;
+			b[i++] = ok;
+			if (sim->offsets) {
+				buffer_append_uint32(b, offset, &i);
+			}
+			acknowledge(sim, b, i);
+			return;
+		}
+
+		default:
+			return;
+	}
+}
+
+static void simulate(simulator * sim) {
+
+	for (;;) {
+		// Sleep until the next acknowledgement is due or a write arrives
+		int timeout = -1;
+		for (int a = 0; a < sim->ackCount; a++) {
+			int32_t wait = (int32_t)(sim->acks[a].due - millis());
+			wait = wait < 0 ? 0 : wait;
+			timeout = (timeout < 0 || wait < timeout) ? wait : timeout;
+		}
+
+		struct pollfd pfd;
+		pfd.fd = sim->fd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, timeout) > 0) {
+			ssize_t r = read(sim->fd, sim->rx + sim->rxLen, sizeof(sim->rx) - sim->rxLen);
+			if (r > 0) {
+				sim->rxLen += r;
+			}
+
+			// [2][len][payload][crc16][3] or [3][len16][payload][crc16][3]
+			int pos = 0;
+			while (sim->rxLen - pos >= 3) {
+				if (sim->rx[pos] != 2 && sim->rx[pos] != 3) {
+					pos++;
+					continue;
+				}
+				int header = sim->rx[pos] == 2 ? 2 : 3;
+				int len = header == 2 ? sim->rx[pos + 1] : (sim->rx[pos + 1] << 8 | sim->rx[pos + 2]);
+				if (sim->rxLen - pos < header + len + 3) {
+					break;
+				}
+				handle(sim, sim->rx + pos + header, len);
+				pos += header + len + 3;
+			}
+			memmove(sim->rx, sim->rx + pos, sim->rxLen - pos);
+			sim->rxLen -= pos;
+		}
+
+		for (int a = 0; a < sim->ackCount; a++) {
+			if ((int32_t)(millis() - sim->acks[a].due) >= 0) {
+				sendFrame(sim->fd, sim->acks[a].payload, sim->acks[a].len);
+				sim->acks[a--] = sim->acks[--sim->ackCount];
+			}
+		}
+	}
+}
+
+/* Uploader side */
+
+// FdStream that moves bytes to and from the descriptor whenever VescUart looks for input,
+// as nothing else drives it outside of VescEventLoop
+class linkStream : public FdStream
+{
+	public:
+		linkStream(int fd) : FdStream(fd) {}
+
+		int available(void) override {
+			flushToFd();
+			readFromFd();
+			return FdStream::available();
+		}
+};
+
+class imageStream : public Stream
+{
+	public:
+		imageStream(const uint8_t * data, uint32_t size) : data(data), size(size) {}
+
+		int available(void) override { return size - position; }
+		int read(void) override { return position < size ? data[position++] : -1; }
+		int peek(void) override { return position < size ? data[position] : -1; }
+		size_t write(uint8_t) override { return 0; }
+
+	private:
+		const uint8_t * data;
+		uint32_t size;
+		uint32_t position = 0;
+};
+
+static int openPty(int * master) {
+
+	*master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0) {
+		return -1;
+	}
+
+	int slave = open(ptsname(*master), O_RDWR | O_NOCTTY);
+	if (slave < 0) {
+		return -1;
+	}
+
+	// Binary frames, no line discipline on either side
+	struct termios tty;
+	tcgetattr(slave, &tty);
+	cfmakeraw(&tty);
+	tcsetattr(slave, TCSANOW, &tty);
+	return slave;
+}
+
+static void bench(const uint8_t * image, uint32_t size, scenario link, bool offsets) {
+
+	static simulator sim;
+	int slave = openPty(&sim.fd);
+	if (slave < 0) {
+		perror("pty");
+		exit(1);
+	}
+
+	pid_t child = fork();
+	if (child == 0) {
+		close(slave);
+		sim.offsets = offsets;
+		sim.link = link;
+		sim.rxLen = 0;
+		sim.ackCount = 0;
+		sim.flash = (uint8_t *)malloc(FLASH_SIZE);
+		srand(1);
+		simulate(&sim);
+		_exit(0);
+	}
+	close(sim.fd);
+
+	VescUart vesc;
+	linkStream stream(slave);
+	vesc.setSerialPort(&stream);
+
+	// Random data does not compress, and the simulator only takes plain chunks
+	VescUploader uploader(vesc);
+	uploader.setCompression(false);
+	imageStream source(image, size);
+	bool ok = uploader.upload(source, size);
+
+	printf("%-7s %6u %8.1f%% %6.1f%% %9.1f %8u  %s\n", offsets ? "offset" : "none", link.delay_ms,
+		100 * link.dropped, 100 * link.late, uploader.bytesPerSecond() / 1024, uploader.retransmissions, ok ? "ok" : "FAILED");
+
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	close(slave);
+}
+
+int main(int argc, char ** argv) {
+
+	uint32_t size = (argc > 1 ? atoi(argv[1]) : 128) * 1024;
+	if (size == 0 || size + 6 > FLASH_SIZE) {
+		fprintf(stderr, "Image size between 1 and %d kB\n", FLASH_SIZE / 1024 - 1);
+		return 1;
+	}
+
+	uint8_t * image = (uint8_t *)malloc(size);
+	for (uint32_t i = 0; i < size; i++) {
+		image[i] = rand();
+	}
+
+	static const scenario links[] = {
+		{ 0, 0, 0 },
+		{ 2, 0, 0 },
+		{ 10, 0, 0 },
+		{ 2, 0.01f, 0 },
+		{ 2, 0, 0.01f },
+	};
+
+	printf("%u kB image, %d byte chunks, window %d, acknowledgement timeout %d ms\n", size / 1024,
+		VESCUPLOADER_CHUNK_SIZE, VESCUPLOADER_WINDOW, VESCUPLOADER_ACK_TIMEOUT);
+	printf("acks     delay  dropped   late     kB/s  resent  image\n");
+
+	for (unsigned l = 0; l < sizeof(links) / sizeof(links[0]); l++) {
+		bench(image, size, links[l], true);
+		bench(image, size, links[l], false);
+	}
+
+	free(image);
+	return 0;
+}
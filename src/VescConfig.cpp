@@ -0,0 +1,184 @@
+#include "VescUart.h"
+#include "confgenerator.h"
+
+// Left out when a configuration reply does not fit the receive buffer (AVR); VescConfig.h
+// reports that to the sketches that use it
+#if VESCUART_RX_BUFFER_SIZE >= 1 + MCCONF_SERIALIZED_SIZE && VESCUART_RX_BUFFER_SIZE >= 1 + APPCONF_SERIALIZED_SIZE
+
+#include "VescConfig.h"
+
+VescConfig::VescConfig(VescUart & uart) : uart(uart) {
+	invalidateAll();
+}
+
+bool VescConfig::getMcconf(mc_configuration * conf) {
+	return getMcconf(conf, 0);
+}
+
+bool VescConfig::getMcconf(mc_configuration * conf, uint8_t canId) {
+
+	confCacheEntry * entry = findEntry(mcconfCache, canId, MCCONF_SIGNATURE, false);
+
+	if (entry == NULL) {
+		entry = fetch(COMM_GET_MCCONF, MCCONF_SERIALIZED_SIZE, MCCONF_SIGNATURE, canId);
+		if (entry == NULL) {
+			return false;
+		}
+	}
+
+	return confgenerator_deserialize_mcconf(entry->blob, MCCONF_SERIALIZED_SIZE, conf);
+}
+
+bool VescConfig::setMcconf(const mc_configuration * conf) {
+	return setMcconf(conf, 0);
+}
+
+bool VescConfig::setMcconf(const mc_configuration * conf, uint8_t canId) {
+
+	// Read first if not cached: a firmware with another layout must not be written to
+	confCacheEntry * entry = findEntry(mcconfCache, canId, MCCONF_SIGNATURE, false);
+
+	if (entry == NULL) {
+		entry = fetch(COMM_GET_MCCONF, MCCONF_SERIALIZED_SIZE, MCCONF_SIGNATURE, canId);
+		if (entry == NULL) {
+			return false;
+		}
+	}
+
+	confgenerator_serialize_mcconf(buffer + 1, conf);
+
+	return store(COMM_SET_MCCONF, MCCONF_SERIALIZED_SIZE, entry, canId);
+}
+
+bool VescConfig::getAppconf(app_configuration * conf) {
+	return getAppconf(conf, 0);
+}
+
+bool VescConfig::getAppconf(app_configuration * conf, uint8_t canId) {
+
+	confCacheEntry * entry = findEntry(appconfCache, canId, APPCONF_SIGNATURE, false);
+
+	if (entry == NULL) {
+		entry = fetch(COMM_GET_APPCONF, APPCONF_SERIALIZED_SIZE, APPCONF_SIGNATURE, canId);
+		if (entry == NULL) {
+			return false;
+		}
+	}
+
+	return confgenerator_deserialize_appconf(entry->blob, APPCONF_SERIALIZED_SIZE, conf);
+}
+
+bool VescConfig::setAppconf(const app_configuration * conf) {
+	return setAppconf(conf, 0);
+}
+
+bool VescConfig::setAppconf(const app_configuration * conf, uint8_t canId) {
+
+	// Read first if not cached: a firmware with another layout must not be written to
+	confCacheEntry * entry = findEntry(appconfCache, canId, APPCONF_SIGNATURE, false);
+
+	if (entry == NULL) {
+		entry = fetch(COMM_GET_APPCONF, APPCONF_SERIALIZED_SIZE, APPCONF_SIGNATURE, canId);
+		if (entry == NULL) {
+			return false;
+		}
+	}
+
+	confgenerator_serialize_appconf(buffer + 1, conf);
+
+	return store(COMM_SET_APPCONF, APPCONF_SERIALIZED_SIZE, entry, canId);
+}
+
+void VescConfig::invalidate(uint8_t canId) {
+
+	for (uint8_t i = 0; i < VESCCONFIG_CACHE_SIZE; i++) {
+		if (mcconfCache[i].canId == canId) {
+			mcconfCache[i].used = false;
+		}
+		if (appconfCache[i].canId == canId) {
+			appconfCache[i].used = false;
+		}
+	}
+}
+
+void VescConfig::invalidateAll(void) {
+	memset(mcconfCache, 0, sizeof(mcconfCache));
+	memset(appconfCache, 0, sizeof(appconfCache));
+	cacheNext = 0;
+}
+
+VescConfig::confCacheEntry * VescConfig::findEntry(confCacheEntry * cache, uint8_t canId, uint32_t signature, bool create) {
+
+	confCacheEntry * freeEntry = NULL;
+
+	for (uint8_t i = 0; i < VESCCONFIG_CACHE_SIZE; i++) {
+		if (cache[i].used && cache[i].canId == canId && cache[i].signature == signature) {
+			return &cache[i];
+		}
+		if (!cache[i].used && freeEntry == NULL) {
+			freeEntry = &cache[i];
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	if (freeEntry == NULL) {
+		freeEntry = &cache[cacheNext];
+		cacheNext = (cacheNext + 1) % VESCCONFIG_CACHE_SIZE;
+	}
+
+	freeEntry->used = true;
+	freeEntry->canId = canId;
+	freeEntry->signature = signature;
+	return freeEntry;
+}
+
+VescConfig::confCacheEntry * VescConfig::fetch(COMM_PACKET_ID packetId, int size, uint32_t signature, uint8_t canId) {
+
+	uint8_t payload[1] = { (uint8_t)packetId };
+
+	uart.packSendPayload(payload, 1, canId);
+
+	int messageLength = uart.waitForPacket(packetId, canId, uart._TIMEOUT);
+
+	if (messageLength < 5) {
+		return NULL;
+	}
+
+	// Another firmware has another signature and field layout; do not misread it, and do not
+	// keep an entry that would let a write through
+	int32_t index = 1;
+	if (buffer_get_uint32(uart.rxBuffer, &index) != signature || messageLength != size + 1) {
+		if (uart.debugPort != NULL) {
+			uart.debugPort->println("Configuration signature does not match the supported firmware");
+		}
+		return NULL;
+	}
+
+	confCacheEntry * entry = findEntry(packetId == COMM_GET_MCCONF ? mcconfCache : appconfCache, canId, signature, true);
+	memcpy(entry->blob, uart.rxBuffer + 1, size);
+	return entry;
+}
+
+bool VescConfig::store(COMM_PACKET_ID packetId, int size, confCacheEntry * entry, uint8_t canId) {
+
+	if (memcmp(entry->blob, buffer + 1, size) == 0) {
+		return true; // Nothing changed, skip the round trip and the flash write
+	}
+
+	buffer[0] = packetId;
+	uart.packSendPayload(buffer, size + 1, canId);
+
+	if (uart.waitForPacket(packetId, canId, VESCCONFIG_WRITE_TIMEOUT) > 0) {
+		memcpy(entry->blob, buffer + 1, size);
+		return true;
+	}
+
+	// The VESC may or may not have applied it, so read it again next time
+	entry->used = false;
+	return false;
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef _VESCCONFIG_h
+#define _VESCCONFIG_h
+
+#include "VescUart.h"
+#include "confgenerator.h"
+
+/** Number of controllers whose configuration is cached. Each entry holds one serialized
+  * mcconf and one serialized appconf, so keep this small on boards with little RAM. */
+#ifndef VESCCONFIG_CACHE_SIZE
+#define VESCCONFIG_CACHE_SIZE 2
+#endif
+
+/** How long to wait for the VESC to store a configuration in flash and acknowledge it */
+#ifndef VESCCONFIG_WRITE_TIMEOUT
+#define VESCCONFIG_WRITE_TIMEOUT 2000
+#endif
+
+/** Size of the largest serialized configuration */
+#define VESCCONFIG_BLOB_SIZE (MCCONF_SERIALIZED_SIZE > APPCONF_SERIALIZED_SIZE ? MCCONF_SERIALIZED_SIZE : APPCONF_SERIALIZED_SIZE)
+
+/** The reply with a configuration is received whole, so it must fit the receive buffer. The
+  * AVR default of 256 bytes is too small; VescConfig.cpp is then left out of the build. */
+#if VESCUART_RX_BUFFER_SIZE < 1 + VESCCONFIG_BLOB_SIZE
+#error "VescConfig needs a VESCUART_RX_BUFFER_SIZE that holds a whole configuration, it is not available on AVR"
+#endif
+
+class VescConfig
+{
+	/** Serialized configuration of a single controller, as last read from or written to it.
+	  * The first 4 bytes are the configuration signature of the firmware. */
+	struct confCacheEntry {
+		bool used;
+		uint8_t canId;
+		uint32_t signature;
+		uint8_t blob[VESCCONFIG_BLOB_SIZE];
+	};
+
+	public:
+		/**
+		 * @brief      Class constructor
+		 * @param      uart  - The VescUart instance used to talk to the VESC
+		 */
+		VescConfig(VescUart & uart);
+
+		/**
+		 * @brief      Read the motor configuration, from the cache if it has been read before
+		 *
+		 * @param      conf  - The configuration to fill
+		 * @return     True if successfull, false if the read failed or the firmware's signature is not MCCONF_SIGNATURE
+		 */
+		bool getMcconf(mc_configuration * conf);
+
+		/**
+		 * @brief      Read the motor configuration, from the cache if it has been read before
+		 *
+		 * @param      conf   - The configuration to fill
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if successfull, false if the read failed or the firmware's signature is not MCCONF_SIGNATURE
+		 */
+		bool getMcconf(mc_configuration * conf, uint8_t canId);
+
+		/**
+		 * @brief      Write the motor configuration. Nothing is sent if it equals the cached one, and
+		 *             nothing is written to a firmware whose signature is not MCCONF_SIGNATURE.
+		 *
+		 * @param      conf  - The configuration to write, usually read with getMcconf() and modified
+		 * @return     True if the VESC acknowledged the configuration or nothing changed
+		 */
+		bool setMcconf(const mc_configuration * conf);
+
+		/**
+		 * @brief      Write the motor configuration. Nothing is sent if it equals the cached one, and
+		 *             nothing is written to a firmware whose signature is not MCCONF_SIGNATURE.
+		 *
+		 * @param      conf   - The configuration to write, usually read with getMcconf() and modified
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if the VESC acknowledged the configuration or nothing changed
+		 */
+		bool setMcconf(const mc_configuration * conf, uint8_t canId);
+
+		/**
+		 * @brief      Read the app configuration, from the cache if it has been read before
+		 *
+		 * @param      conf  - The configuration to fill
+		 * @return     True if successfull, false if the read failed or the firmware's signature is not APPCONF_SIGNATURE
+		 */
+		bool getAppconf(app_configuration * conf);
+
+		/**
+		 * @brief      Read the app configuration, from the cache if it has been read before
+		 *
+		 * @param      conf   - The configuration to fill
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if successfull, false if the read failed or the firmware's signature is not APPCONF_SIGNATURE
+		 */
+		bool getAppconf(app_configuration * conf, uint8_t canId);
+
+		/**
+		 * @brief      Write the app configuration. Nothing is sent if it equals the cached one, and
+		 *             nothing is written to a firmware whose signature is not APPCONF_SIGNATURE.
+		 *
+		 * @param      conf  - The configuration to write, usually read with getAppconf() and modified
+		 * @return     True if the VESC acknowledged the configuration or nothing changed
+		 */
+		bool setAppconf(const app_configuration * conf);
+
+		/**
+		 * @brief      Write the app configuration. Nothing is sent if it equals the cached one, and
+		 *             nothing is written to a firmware whose signature is not APPCONF_SIGNATURE.
+		 *
+		 * @param      conf   - The configuration to write, usually read with getAppconf() and modified
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if the VESC acknowledged the configuration or nothing changed
+		 */
+		bool setAppconf(const app_configuration * conf, uint8_t canId);
+
+		/**
+		 * @brief      Drop the cached configurations of a controller, so they are read again
+		 * @param      canId  - The CAN ID of the VESC
+		 */
+		void invalidate(uint8_t canId);
+
+		/**
+		 * @brief      Drop all cached configurations
+		 */
+		void invalidateAll(void);
+
+	private:
+
+		/** Variabel to hold the reference to the VescUart instance */
+		VescUart & uart;
+
+		/** Cached serialized motor configurations */
+		confCacheEntry mcconfCache[VESCCONFIG_CACHE_SIZE];
+
+		/** Cached serialized app configurations */
+		confCacheEntry appconfCache[VESCCONFIG_CACHE_SIZE];
+
+		/** Next cache entry to evict when the cache is full */
+		uint8_t cacheNext = 0;
+
+		/** Packet buffer: the packet id followed by a serialized configuration */
+		uint8_t buffer[1 + VESCCONFIG_BLOB_SIZE];
+
+		/**
+		 * @brief      Finds the cache entry of a controller. An entry with another signature is a miss.
+		 *
+		 * @param      cache      - mcconfCache or appconfCache
+		 * @param      canId      - The CAN ID of the VESC
+		 * @param      signature  - The configuration signature of the entry
+		 * @param      create     - Allocate (or evict) an entry if none exists
+		 * @return     Pointer to the entry, or NULL if not found
+		 */
+		confCacheEntry * findEntry(confCacheEntry * cache, uint8_t canId, uint32_t signature, bool create);
+
+		/**
+		 * @brief      Reads a serialized configuration from the VESC into the cache
+		 *
+		 * @param      packetId   - COMM_GET_MCCONF or COMM_GET_APPCONF
+		 * @param      size       - Expected size of the serialized configuration
+		 * @param      signature  - Expected configuration signature
+		 * @param      canId      - The CAN ID of the VESC
+		 * @return     Pointer to the cache entry, or NULL if the read failed or the layout does not match
+		 */
+		confCacheEntry * fetch(COMM_PACKET_ID packetId, int size, uint32_t signature, uint8_t canId);
+
+		/**
+		 * @brief      Sends the serialized configuration in buffer if it differs from the cache
+		 *
+		 * @param      packetId  - COMM_SET_MCCONF or COMM_SET_APPCONF
+		 * @param      size      - Size of the serialized configuration in buffer
+		 * @param      entry     - The cache entry of the controller
+		 * @param      canId     - The CAN ID of the VESC
+		 * @return     True if the VESC acknowledged the configuration or nothing changed
+		 */
+		bool store(COMM_PACKET_ID packetId, int size, confCacheEntry * entry, uint8_t canId);
+};
+
+#endif
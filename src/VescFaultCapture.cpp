@@ -0,0 +1,81 @@
+#include "VescFaultCapture.h"
+
+VescFaultCapture::VescFaultCapture(uint8_t canId) : controllerId(canId) {
+}
+
+void VescFaultCapture::setCallback(captureCallback callback, void * context) {
+	this->callback = callback;
+	this->context = context;
+}
+
+void VescFaultCapture::setWindow(uint32_t window_ms) {
+	this->window_ms = window_ms;
+}
+
+void VescFaultCapture::setBurst(VescPlanner * planner, float rate_hz) {
+	this->planner = planner;
+	burstRate = rate_hz;
+}
+
+void VescFaultCapture::addSample(const VescUart::rawDataPackage & values) {
+
+	bool hasFault = values.fields & VALUES_MASK_FAULT;
+
+	if (state == STATE_CAPTURING) {
+		if (postCount < VESCFAULTCAPTURE_POST_SAMPLES) {
+			buffer[VESCFAULTCAPTURE_PRE_SAMPLES + postCount++] = values;
+		}
+		if (postCount == VESCFAULTCAPTURE_POST_SAMPLES || values.rxTime_us - triggerTime_us >= window_ms * 1000) {
+			complete();
+		}
+		return;
+	}
+
+	if (hasFault && values.error != FAULT_CODE_NONE && state == STATE_ARMED) {
+		// Freeze the ring; the fault sample starts the part after the trigger
+		state = STATE_CAPTURING;
+		faultCode = values.error;
+		triggerTime_us = values.rxTime_us;
+		buffer[VESCFAULTCAPTURE_PRE_SAMPLES] = values;
+		postCount = 1;
+
+		if (planner != NULL && burstRate > 0) {
+			planner->setBurst(controllerId, burstRate, window_ms);
+		}
+		if (window_ms == 0 || postCount == VESCFAULTCAPTURE_POST_SAMPLES) {
+			complete();
+		}
+		return;
+	}
+
+	if (hasFault && values.error == FAULT_CODE_NONE) {
+		state = STATE_ARMED;
+	}
+
+	buffer[preHead] = values;
+	preHead = (preHead + 1) % VESCFAULTCAPTURE_PRE_SAMPLES;
+	if (preCount < VESCFAULTCAPTURE_PRE_SAMPLES) {
+		preCount++;
+	}
+}
+
+const VescUart::rawDataPackage & VescFaultCapture::sample(uint16_t index) {
+	if (index < preCount) {
+		return buffer[(preHead + VESCFAULTCAPTURE_PRE_SAMPLES - preCount + index) % VESCFAULTCAPTURE_PRE_SAMPLES];
+	}
+	return buffer[VESCFAULTCAPTURE_PRE_SAMPLES + index - preCount];
+}
+
+void VescFaultCapture::complete(void) {
+
+	captures++;
+	if (callback != NULL) {
+		callback(*this, context);
+	}
+
+	// Start the next history from scratch, and wait for the fault to clear before arming again
+	state = STATE_WAITING;
+	preHead = 0;
+	preCount = 0;
+	postCount = 0;
+}
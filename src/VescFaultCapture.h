@@ -0,0 +1,122 @@
+#ifndef _VESCFAULTCAPTURE_h
+#define _VESCFAULTCAPTURE_h
+
+#include "VescUart.h"
+#include "VescPlanner.h"
+
+/** Samples kept from before a fault */
+#ifndef VESCFAULTCAPTURE_PRE_SAMPLES
+#if defined(__AVR__)
+#define VESCFAULTCAPTURE_PRE_SAMPLES 4
+#else
+#define VESCFAULTCAPTURE_PRE_SAMPLES 64
+#endif
+#endif
+
+/** Samples kept from the fault on */
+#ifndef VESCFAULTCAPTURE_POST_SAMPLES
+#if defined(__AVR__)
+#define VESCFAULTCAPTURE_POST_SAMPLES 4
+#else
+#define VESCFAULTCAPTURE_POST_SAMPLES 64
+#endif
+#endif
+
+/** Default time after the fault that is captured */
+#ifndef VESCFAULTCAPTURE_WINDOW_MS
+#define VESCFAULTCAPTURE_WINDOW_MS 500
+#endif
+
+class VescFaultCapture
+{
+	public:
+
+		/** Called with a complete capture, and the context given to setCallback() */
+		typedef void (*captureCallback)(VescFaultCapture & capture, void * context);
+
+		/**
+		 * @brief      Class constructor
+		 * @param      canId  - The CAN ID of the controller whose samples are added, 0 for the one on the UART
+		 */
+		VescFaultCapture(uint8_t canId);
+
+		/**
+		 * @brief      Sets the function that receives each capture. The capture is only valid
+		 *             during the call.
+		 */
+		void setCallback(captureCallback callback, void * context);
+
+		/**
+		 * @brief      Sets how long after the fault samples are captured
+		 * @param      window_ms  - VESCFAULTCAPTURE_WINDOW_MS by default
+		 */
+		void setWindow(uint32_t window_ms);
+
+		/**
+		 * @brief      Polls the controller faster while capturing after a fault
+		 * @param      planner  - The planner that polls it, NULL to leave the poll rate alone
+		 * @param      rate_hz  - Polls per second during the capture window
+		 */
+		void setBurst(VescPlanner * planner, float rate_hz);
+
+		/**
+		 * @brief      Adds a sample of the controller. When its error changes from FAULT_CODE_NONE
+		 *             the samples before it are kept, the samples of the next window_ms are added to
+		 *             them, then the callback is called. The next capture starts once the error is
+		 *             back to FAULT_CODE_NONE. Samples without the fault field are only recorded.
+		 * @param      values  - The decoded values, e.g. VescUart::dataRaw after update()
+		 */
+		void addSample(const VescUart::rawDataPackage & values);
+
+		/** @return True from the fault until the capture is complete */
+		bool capturing(void) { return state == STATE_CAPTURING; }
+
+		/** The capture, in the callback */
+		uint8_t canId(void) { return controllerId; }
+		mc_fault_code fault(void) { return faultCode; }
+
+		/** @return Number of samples in the capture */
+		uint16_t length(void) { return preCount + postCount; }
+
+		/** @return Index of the first sample with the fault, the samples before it are the pre-trigger history */
+		uint16_t triggerIndex(void) { return preCount; }
+
+		/**
+		 * @brief      A sample of the capture, oldest first
+		 * @param      index  - Between 0 and length() - 1
+		 */
+		const VescUart::rawDataPackage & sample(uint16_t index);
+
+		/** Number of captures completed */
+		uint32_t captures = 0;
+
+	private:
+
+		enum captureState {
+			STATE_WAITING,		// For FAULT_CODE_NONE, after a capture or at the start
+			STATE_ARMED,		// Recording the pre-trigger ring
+			STATE_CAPTURING		// Filling the samples after the fault
+		};
+
+		uint8_t controllerId;
+		captureState state = STATE_WAITING;
+		mc_fault_code faultCode = FAULT_CODE_NONE;
+		uint32_t triggerTime_us = 0;
+		uint32_t window_ms = VESCFAULTCAPTURE_WINDOW_MS;
+
+		VescPlanner * planner = NULL;
+		float burstRate = 0;
+
+		captureCallback callback = NULL;
+		void * context = NULL;
+
+		/** The pre-trigger ring, then the samples from the fault on */
+		VescUart::rawDataPackage buffer[VESCFAULTCAPTURE_PRE_SAMPLES + VESCFAULTCAPTURE_POST_SAMPLES];
+		uint16_t preHead = 0;
+		uint16_t preCount = 0;
+		uint16_t postCount = 0;
+
+		void complete(void);
+};
+
+#endif
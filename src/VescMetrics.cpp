@@ -0,0 +1,149 @@
+#include "VescMetrics.h"
+
+// Kahan summation: error keeps what the last add to sum rounded off, so that adding and removing
+// every sample of a running window does not build up rounding errors
+static void addCompensated(float & sum, float & error, float value) {
+	float y = value - error;
+	float t = sum + y;
+	error = (t - sum) - y;
+	sum = t;
+}
+
+VescMetrics::VescMetrics(void) {
+	reset();
+}
+
+void VescMetrics::reset(void) {
+	memset(current, 0, sizeof(current));
+	memset(ewma, 0, sizeof(ewma));
+	memset(low, 0, sizeof(low));
+	memset(high, 0, sizeof(high));
+	memset(windowSum, 0, sizeof(windowSum));
+	memset(windowError, 0, sizeof(windowError));
+	windowNext = 0;
+	windowCount = 0;
+	drawn_Ws = 0;
+	regenerated_Ws = 0;
+	tachSteps = 0;
+	samples = 0;
+}
+
+void VescMetrics::setTimeConstant(uint32_t tau_ms) {
+	this->tau_ms = tau_ms;
+}
+
+void VescMetrics::setMetersPerTach(float meters) {
+	metersPerTach = meters;
+}
+
+void VescMetrics::addSample(const VescUart::dataPackage & values) {
+
+	float previousInputPower = current[METRIC_INPUT_POWER];
+
+	current[METRIC_INPUT_POWER]		= values.inpVoltage * values.avgInputCurrent;
+	current[METRIC_MOTOR_POWER]		= values.inpVoltage * values.dutyCycleNow * values.avgMotorCurrent;
+	current[METRIC_INPUT_CURRENT]	= values.avgInputCurrent;
+	current[METRIC_MOTOR_CURRENT]	= values.avgMotorCurrent;
+	current[METRIC_VOLTAGE]			= values.inpVoltage;
+	current[METRIC_DUTY]			= values.dutyCycleNow;
+	current[METRIC_RPM]				= values.rpm;
+	current[METRIC_TEMP_MOSFET]		= values.tempMosfet;
+	current[METRIC_TEMP_MOTOR]		= values.tempMotor;
+
+	// Weight of the new sample for the time since the last one: dt / (tau + dt) is close to
+	// 1 - exp(-dt / tau) without the exp, and still correct for uneven sample times
+	float alpha = 1;
+	if (samples > 0) {
+		uint32_t dt_us = values.rxTime_us - lastTime_us;
+		float dt = dt_us * 1e-6f;
+		alpha = tau_ms > 0 ? dt / (tau_ms * 1e-3f + dt) : 1;
+
+		float power = (previousInputPower + current[METRIC_INPUT_POWER]) / 2;
+		if (power > 0) {
+			drawn_Ws += power * dt;
+		} else {
+			regenerated_Ws -= power * dt;
+		}
+
+		// tachometerAbs only grows, the difference also holds across its wrap
+		tachSteps += (uint32_t)(values.tachometerAbs - lastTach);
+	}
+	lastTime_us = values.rxTime_us;
+	lastTach = values.tachometerAbs;
+
+	for (uint8_t m = 0; m < METRIC_COUNT; m++) {
+		float value = current[m];
+
+		ewma[m] += (value - ewma[m]) * alpha;
+
+		if (samples == 0 || value < low[m]) {
+			low[m] = value;
+		}
+		if (samples == 0 || value > high[m]) {
+			high[m] = value;
+		}
+
+		if (windowCount == VESCMETRICS_WINDOW) {
+			addCompensated(windowSum[m], windowError[m], -window[m][windowNext]);
+		}
+		window[m][windowNext] = value;
+		addCompensated(windowSum[m], windowError[m], value);
+	}
+
+	windowNext = windowNext + 1 < VESCMETRICS_WINDOW ? windowNext + 1 : 0;
+	if (windowCount < VESCMETRICS_WINDOW) {
+		windowCount++;
+	}
+	samples++;
+}
+
+float VescMetrics::last(metric m) {
+	return current[m];
+}
+
+float VescMetrics::average(metric m) {
+	return ewma[m];
+}
+
+float VescMetrics::windowMean(metric m) {
+	return windowCount > 0 ? windowSum[m] / windowCount : 0;
+}
+
+float VescMetrics::minimum(metric m) {
+	return low[m];
+}
+
+float VescMetrics::maximum(metric m) {
+	return high[m];
+}
+
+float VescMetrics::efficiency(void) {
+
+	float input = ewma[METRIC_INPUT_POWER];
+	float motor = ewma[METRIC_MOTOR_POWER];
+
+	if (input > 0 && motor > 0) {
+		return motor < input ? motor / input : 1;
+	}
+	if (input < 0 && motor < 0) {
+		return input > motor ? input / motor : 1;
+	}
+	return 0;
+}
+
+float VescMetrics::energyDrawn(void) {
+	return drawn_Ws / 3600;
+}
+
+float VescMetrics::energyRegenerated(void) {
+	return regenerated_Ws / 3600;
+}
+
+float VescMetrics::distance(void) {
+	return tachSteps * metersPerTach;
+}
+
+float VescMetrics::whPerKm(void) {
+	float meters = distance();
+	return meters >= 1 ? (drawn_Ws - regenerated_Ws) / 3600 / (meters / 1000) : 0;
+}
@@ -0,0 +1,122 @@
+#ifndef _VESCMETRICS_h
+#define _VESCMETRICS_h
+
+#include "VescUart.h"
+
+/** Number of samples in the moving window */
+#ifndef VESCMETRICS_WINDOW
+#if defined(__AVR__)
+#define VESCMETRICS_WINDOW 8
+#else
+#define VESCMETRICS_WINDOW 64
+#endif
+#endif
+
+/** Default time constant of the exponential averages */
+#ifndef VESCMETRICS_TIME_CONSTANT_MS
+#define VESCMETRICS_TIME_CONSTANT_MS 1000
+#endif
+
+class VescMetrics
+{
+	public:
+
+		/** The values with running statistics */
+		enum metric {
+			METRIC_INPUT_POWER,		// W, input voltage * input current
+			METRIC_MOTOR_POWER,		// W, input voltage * duty cycle * motor current
+			METRIC_INPUT_CURRENT,	// A
+			METRIC_MOTOR_CURRENT,	// A
+			METRIC_VOLTAGE,			// V
+			METRIC_DUTY,			// 0 - 1
+			METRIC_RPM,				// ERPM
+			METRIC_TEMP_MOSFET,		// degC
+			METRIC_TEMP_MOTOR,		// degC
+			METRIC_COUNT
+		};
+
+		VescMetrics(void);
+
+		/**
+		 * @brief      Adds a sample of one controller. Every update is O(1), the derived values are
+		 *             only computed when read. Use one instance per controller.
+		 * @param      values  - The decoded values, e.g. VescUart::data after getVescValues(), or
+		 *                       after update() and convertRawValues(). Its rxTime_us is the time of the sample.
+		 */
+		void addSample(const VescUart::dataPackage & values);
+
+		/**
+		 * @brief      Clears the statistics, the energy and the distance
+		 */
+		void reset(void);
+
+		/**
+		 * @brief      Sets the time constant of the exponential averages
+		 * @param      tau_ms  - Time for the average to move most of the way to a new steady value
+		 */
+		void setTimeConstant(uint32_t tau_ms);
+
+		/**
+		 * @brief      Sets the distance covered per tachometer step, for distance() and whPerKm()
+		 * @param      meters  - Wheel circumference / (3 * motor poles * gear ratio)
+		 */
+		void setMetersPerTach(float meters);
+
+		/**
+		 * @brief      Statistics of a metric
+		 * @param      m  - The metric
+		 * @return     0 before the first sample
+		 */
+		float last(metric m);
+		float average(metric m);		// Exponential average with the time constant
+		float windowMean(metric m);		// Mean of the last VESCMETRICS_WINDOW samples
+		float minimum(metric m);		// Since reset()
+		float maximum(metric m);
+
+		/**
+		 * @brief      Share of the average input power that reaches the motor, or of the motor power
+		 *             that reaches the battery while braking
+		 * @return     Between 0 and 1, 0 while the sign of the two powers differs
+		 */
+		float efficiency(void);
+
+		/** Energy drawn from and returned to the battery since reset(), in Wh */
+		float energyDrawn(void);
+		float energyRegenerated(void);
+
+		/** Distance since reset() in m, 0 without setMetersPerTach() */
+		float distance(void);
+
+		/** Net energy per distance since reset(), 0 before the first meter */
+		float whPerKm(void);
+
+		/** Samples added since reset() */
+		uint32_t samples = 0;
+
+	private:
+
+		uint32_t tau_ms = VESCMETRICS_TIME_CONSTANT_MS;
+		float metersPerTach = 0;
+
+		float current[METRIC_COUNT];
+		float ewma[METRIC_COUNT];
+		float low[METRIC_COUNT];
+		float high[METRIC_COUNT];
+
+		/** Ring of the last samples of every metric, and their running sums */
+		float window[METRIC_COUNT][VESCMETRICS_WINDOW];
+		float windowSum[METRIC_COUNT];
+		float windowError[METRIC_COUNT];	// Rounding error of windowSum, compensated on the next add
+		uint16_t windowNext = 0;
+		uint16_t windowCount = 0;
+
+		/** Integrals, in Ws; trapezoidal between samples */
+		float drawn_Ws = 0;
+		float regenerated_Ws = 0;
+		uint32_t tachSteps = 0;
+
+		uint32_t lastTime_us = 0;
+		long lastTach = 0;
+};
+
+#endif
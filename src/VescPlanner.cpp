@@ -0,0 +1,271 @@
+#include "VescPlanner.h"
+
+VescPlanner::VescPlanner(VescUart & uart, uint32_t baud) : uart(uart), baud(baud) {
+	uart.setBaudRate(baud);
+}
+
+bool VescPlanner::addController(uint8_t canId, float rate_hz, uint32_t mask) {
+
+	if (rate_hz <= 0) {
+		return false;
+	}
+
+	target * t = findTarget(canId);
+	if (t == NULL) {
+		if (count == VESCPLANNER_MAX_CONTROLLERS) {
+			return false;
+		}
+		t = &targets[count++];
+	}
+
+	t->canId = canId;
+	t->rate = rate_hz;
+	t->mask = mask & VALUES_MASK_ALL;
+	t->adaptive = false;
+	t->burstRate = 0;
+	planned = false;
+	return true;
+}
+
+bool VescPlanner::setAdaptive(uint8_t canId, float minRate_hz, float maxRate_hz) {
+
+	target * t = findTarget(canId);
+	if (t == NULL || minRate_hz <= 0 || maxRate_hz < minRate_hz) {
+		return false;
+	}
+
+	t->adaptive = true;
+	t->minRate = minRate_hz;
+	t->maxRate = maxRate_hz;
+	t->sampled = false;
+	t->mask |= VALUES_MASK_RPM | VALUES_MASK_MOTOR_CURRENT | VALUES_MASK_DUTY;
+	t->rate = t->rate < minRate_hz ? minRate_hz : (t->rate > maxRate_hz ? maxRate_hz : t->rate);
+	t->smoothRate = t->rate;
+	planned = false;
+	return true;
+}
+
+void VescPlanner::setActivityScale(float rpmPerSecond, float currentPerSecond, float dutyPerSecond) {
+	rpmScale = rpmPerSecond;
+	currentScale = currentPerSecond;
+	dutyScale = dutyPerSecond;
+}
+
+void VescPlanner::addSample(uint8_t canId, const VescUart::dataPackage & values) {
+
+	target * t = findTarget(canId);
+	if (t == NULL || !t->adaptive) {
+		return;
+	}
+
+	uint32_t now = millis();
+	uint32_t dt = now - t->lastSample;
+	bool first = !t->sampled;
+
+	if (!first && dt == 0) {
+		return; // Too close to the last sample to tell a rate of change
+	}
+
+	float activity = 0;
+	if (!first) {
+		// The fastest changing signal, relative to the rate of change that needs the maximum poll rate
+		float rpm = fabsf(values.rpm - t->lastRpm) * 1000 / dt / rpmScale;
+		float current = fabsf(values.avgMotorCurrent - t->lastCurrent) * 1000 / dt / currentScale;
+		float duty = fabsf(values.dutyCycleNow - t->lastDuty) * 1000 / dt / dutyScale;
+		activity = rpm > current ? rpm : current;
+		activity = activity > duty ? activity : duty;
+		if (activity > 1) {
+			activity = 1;
+		}
+	}
+
+	t->sampled = true;
+	t->lastSample = now;
+	t->lastRpm = values.rpm;
+	t->lastCurrent = values.avgMotorCurrent;
+	t->lastDuty = values.dutyCycleNow;
+
+	if (first) {
+		return;
+	}
+
+	// Speed up at once, slow down gradually so a short pause in a transient does not drop the rate
+	float rate = t->minRate + (t->maxRate - t->minRate) * activity;
+	if (rate < t->smoothRate) {
+		float step = dt >= VESCPLANNER_DECAY_MS ? 1 : (float)dt / VESCPLANNER_DECAY_MS;
+		rate = t->smoothRate + (rate - t->smoothRate) * step;
+	}
+	t->smoothRate = rate;
+
+	// Replanning moves the turns of everyone, so skip changes too small to matter
+	if (fabsf(rate - t->rate) < t->rate * 0.05f) {
+		return;
+	}
+	t->rate = rate;
+	if (planned) {
+		schedule();
+	}
+}
+
+bool VescPlanner::setBurst(uint8_t canId, float rate_hz, uint32_t duration_ms) {
+
+	target * t = findTarget(canId);
+	if (t == NULL || rate_hz <= 0) {
+		return false;
+	}
+
+	t->burstRate = rate_hz;
+	t->burstEnd = millis() + duration_ms;
+	if (planned) {
+		schedule();
+	}
+	return true;
+}
+
+float VescPlanner::getRate(uint8_t canId) {
+	target * t = findTarget(canId);
+	return t != NULL ? rateOf(t) : 0;
+}
+
+float VescPlanner::rateOf(const target * t) {
+	return t->burstRate > t->rate ? t->burstRate : t->rate;
+}
+
+void VescPlanner::clear(void) {
+	count = 0;
+	planned = false;
+}
+
+void VescPlanner::setMaxLoad(float load) {
+	maxLoad = load;
+	planned = false;
+}
+
+bool VescPlanner::plan(void) {
+
+	for (uint8_t i = 0; i < count; i++) {
+		target * t = &targets[i];
+
+		uart.queryFWversionOnce(t->canId);
+
+		// Replies to forwarded requests come back without the CAN prefix
+		int forward = t->canId != 0 ? 2 : 0;
+		uint32_t fields = uart.getValuesFields(t->canId);
+		int fullReply = 1 + VescUart::valuesSize(fields);
+		int selectiveReply = 1 + 4 + VescUart::valuesSize(t->mask & fields);
+
+		// COMM_GET_VALUES_SELECTIVE is only used with firmware 5 and newer
+		t->selective = uart.getValuesLayout(t->canId) == VescUart::VALUES_LAYOUT_FW5 && selectiveReply < fullReply;
+		t->requestBytes = frameBytes(1 + forward + (t->selective ? 4 : 0));
+		t->replyBytes = frameBytes(t->selective ? selectiveReply : fullReply);
+		t->credit = 0;
+	}
+
+	schedule();
+	nextTurn = micros();
+	planned = true;
+
+	if (scale < 1 && uart.debugPort != NULL) {
+		uart.debugPort->print("Poll plan needs ");
+		uart.debugPort->print((rxLoad > txLoad ? rxLoad : txLoad) * 100);
+		uart.debugPort->print("% of the link, rates scaled by ");
+		uart.debugPort->println(scale);
+	}
+
+	return scale >= 1;
+}
+
+void VescPlanner::schedule(void) {
+
+	float rxBytes = 0;
+	float txBytes = 0;
+
+	totalRate = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		float rate = rateOf(&targets[i]);
+		rxBytes += rate * targets[i].replyBytes;
+		txBytes += rate * targets[i].requestBytes;
+		totalRate += rate;
+	}
+
+	// 10 bits per byte with start and stop bit
+	rxLoad = rxBytes * 10 / baud;
+	txLoad = txBytes * 10 / baud;
+
+	float load = rxLoad > txLoad ? rxLoad : txLoad;
+	scale = load > maxLoad ? maxLoad / load : 1;
+
+	interval_us = totalRate > 0 ? (uint32_t)(1000000.0f / (totalRate * scale)) : 0;
+}
+
+bool VescPlanner::poll(void) {
+
+	if (!planned || count == 0) {
+		return false;
+	}
+
+	// Back to the normal rates once a burst is over
+	bool burstEnded = false;
+	for (uint8_t i = 0; i < count; i++) {
+		if (targets[i].burstRate > 0 && (int32_t)(millis() - targets[i].burstEnd) >= 0) {
+			targets[i].burstRate = 0;
+			burstEnded = true;
+		}
+	}
+	if (burstEnded) {
+		schedule();
+	}
+
+	uint32_t now = micros();
+	if ((int32_t)(now - nextTurn) < 0) {
+		return false;
+	}
+
+	// Keep the pace, but do not send a burst to catch up after a stall
+	nextTurn += interval_us;
+	if ((int32_t)(now - nextTurn) > 0) {
+		nextTurn = now;
+	}
+
+	target * t = nextTarget();
+	if (t->selective) {
+		uart.requestVescValuesSelective(t->mask, t->canId);
+	} else {
+		uart.requestVescValues(t->canId);
+	}
+	return true;
+}
+
+uint32_t VescPlanner::frameTime_us(int payloadLen, uint32_t baud) {
+	return (uint32_t)((uint64_t)frameBytes(payloadLen) * 10 * 1000000 / baud);
+}
+
+VescPlanner::target * VescPlanner::findTarget(uint8_t canId) {
+	for (uint8_t i = 0; i < count; i++) {
+		if (targets[i].canId == canId) {
+			return &targets[i];
+		}
+	}
+	return NULL;
+}
+
+int VescPlanner::frameBytes(int payloadLen) {
+	// Start byte, one or two length bytes, payload, CRC16 and stop byte
+	return payloadLen + (payloadLen > 255 ? 6 : 5);
+}
+
+VescPlanner::target * VescPlanner::nextTarget(void) {
+
+	// Smooth weighted round-robin: every turn each controller earns its rate, the richest is
+	// polled and pays the total. Polls of a controller end up evenly spaced, at its share.
+	target * best = &targets[0];
+
+	for (uint8_t i = 0; i < count; i++) {
+		targets[i].credit += rateOf(&targets[i]);
+		if (targets[i].credit > best->credit) {
+			best = &targets[i];
+		}
+	}
+	best->credit -= totalRate;
+	return best;
+}
@@ -0,0 +1,178 @@
+#ifndef _VESCPLANNER_h
+#define _VESCPLANNER_h
+
+#include "VescUart.h"
+
+/** Number of controllers a planner can poll */
+#ifndef VESCPLANNER_MAX_CONTROLLERS
+#if defined(__AVR__)
+#define VESCPLANNER_MAX_CONTROLLERS 4
+#else
+#define VESCPLANNER_MAX_CONTROLLERS 16
+#endif
+#endif
+
+/** Time for an adaptive poll rate to fall most of the way to a lower target once things calm down */
+#ifndef VESCPLANNER_DECAY_MS
+#define VESCPLANNER_DECAY_MS 2000
+#endif
+
+/** Default share of the link the polls may use, leaving room for other traffic and jitter */
+#ifndef VESCPLANNER_MAX_LOAD
+#define VESCPLANNER_MAX_LOAD 0.8f
+#endif
+
+class VescPlanner
+{
+	public:
+
+		/**
+		 * @brief      Class constructor
+		 * @param      uart  - The VescUart instance used to talk to the VESCs
+		 * @param      baud  - Baud rate of its serial port, 8N1
+		 */
+		VescPlanner(VescUart & uart, uint32_t baud);
+
+		/**
+		 * @brief      Adds a controller to poll, or changes its rate and fields if already added
+		 * @param      canId    - The CAN ID of the VESC, 0 for the one on the UART
+		 * @param      rate_hz  - Polls per second
+		 * @param      mask     - The fields needed, see VALUES_MASK_*
+		 * @return     False if the rate is not positive or the planner is full
+		 */
+		bool addController(uint8_t canId, float rate_hz, uint32_t mask);
+
+		/**
+		 * @brief      Lets the poll rate of a controller follow its activity: it rises towards maxRate_hz
+		 *             as rpm, motor current or duty change faster and falls back to minRate_hz when they
+		 *             settle. Adds the rpm, current and duty fields to its mask.
+		 * @param      canId       - The CAN ID of a controller already added
+		 * @param      minRate_hz  - Polls per second when idle
+		 * @param      maxRate_hz  - Polls per second during transients
+		 * @return     False if the controller was not added or the bounds are invalid
+		 */
+		bool setAdaptive(uint8_t canId, float minRate_hz, float maxRate_hz);
+
+		/**
+		 * @brief      Sets the rates of change that call for the maximum poll rate
+		 * @param      rpmPerSecond      - ERPM per second
+		 * @param      currentPerSecond  - Motor current, A per second
+		 * @param      dutyPerSecond     - Duty cycle (0 - 1) per second
+		 */
+		void setActivityScale(float rpmPerSecond, float currentPerSecond, float dutyPerSecond);
+
+		/**
+		 * @brief      Feeds a decoded reply to the adaptive rate of a controller, e.g. after
+		 *             VescUart::update() and convertRawValues(). Replans if the rate changed.
+		 * @param      canId   - The CAN ID the values came from
+		 * @param      values  - The values
+		 */
+		void addSample(uint8_t canId, const VescUart::dataPackage & values);
+
+		/**
+		 * @brief      Polls a controller at least at rate_hz for a while, e.g. right after a fault.
+		 *             Its own rate applies again after duration_ms.
+		 * @param      canId        - The CAN ID of a controller already added
+		 * @param      rate_hz      - Polls per second during the burst
+		 * @param      duration_ms  - Length of the burst
+		 * @return     False if the controller was not added or the rate is not positive
+		 */
+		bool setBurst(uint8_t canId, float rate_hz, uint32_t duration_ms);
+
+		/**
+		 * @brief      Current poll rate of a controller, including a burst, before scale is applied
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     Polls per second, 0 if the controller was not added
+		 */
+		float getRate(uint8_t canId);
+
+		/**
+		 * @brief      Removes all controllers
+		 */
+		void clear(void);
+
+		/**
+		 * @brief      Sets the share of the link the polls may use
+		 * @param      load  - Between 0 and 1, VESCPLANNER_MAX_LOAD by default
+		 */
+		void setMaxLoad(float load);
+
+		/**
+		 * @brief      Computes the wire time of every poll and the schedule. Call it after adding the
+		 *             controllers; it waits for the firmware versions that are not cached yet, as they
+		 *             decide between COMM_GET_VALUES and COMM_GET_VALUES_SELECTIVE.
+		 * @return     True if the requested rates fit the link. If not, all rates are scaled down by
+		 *             scale so that they do, and polling goes on at those rates.
+		 */
+		bool plan(void);
+
+		/**
+		 * @brief      Sends the next request when its turn is due. Call it from loop() together with
+		 *             VescUart::update(), which decodes the replies into dataRaw.
+		 * @return     True if a request was sent
+		 */
+		bool poll(void);
+
+		/**
+		 * @brief      Time a frame takes on the wire
+		 * @param      payloadLen  - Length of the payload, without framing
+		 * @param      baud        - Baud rate, 8N1
+		 * @return     The time in microseconds
+		 */
+		static uint32_t frameTime_us(int payloadLen, uint32_t baud);
+
+		/** Share of the RX (replies) and TX (requests) line the plan needs at the requested rates */
+		float rxLoad = 0;
+		float txLoad = 0;
+
+		/** Factor applied to all rates, below 1 if the requested rates do not fit the link */
+		float scale = 1;
+
+	private:
+
+		/** A controller and its share of the schedule */
+		struct target {
+			uint8_t canId;
+			float rate;
+			uint32_t mask;
+			bool selective;			// COMM_GET_VALUES_SELECTIVE is smaller than the full reply
+			uint16_t requestBytes;	// On the wire, with framing
+			uint16_t replyBytes;
+			float credit;			// Smooth weighted round-robin state
+			bool adaptive;
+			float minRate;
+			float maxRate;
+			float smoothRate;		// Follows the activity on every sample, rate only on larger changes
+			bool sampled;			// The last* fields hold a sample
+			uint32_t lastSample;	// millis()
+			float lastRpm;
+			float lastCurrent;
+			float lastDuty;
+			float burstRate;		// 0 without a burst
+			uint32_t burstEnd;		// millis()
+		};
+
+		VescUart & uart;
+		uint32_t baud;
+		float maxLoad = VESCPLANNER_MAX_LOAD;
+
+		target targets[VESCPLANNER_MAX_CONTROLLERS];
+		uint8_t count = 0;
+
+		float rpmScale = 10000;
+		float currentScale = 50;
+		float dutyScale = 1;
+
+		bool planned = false;
+		float totalRate = 0;
+		uint32_t interval_us = 0;
+		uint32_t nextTurn = 0;
+
+		void schedule(void);
+		static float rateOf(const target * t);
+		target * findTarget(uint8_t canId);
+		static int frameBytes(int payloadLen);
+		target * nextTarget(void);
+};
+
+#endif
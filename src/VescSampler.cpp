@@ -0,0 +1,161 @@
+#include "VescSampler.h"
+
+VescSampler::VescSampler(VescUart & uart) : uart(uart) {
+	blockCount[0] = 0;
+	blockCount[1] = 0;
+}
+
+// Packets collected by the sampler
+static const uint8_t samplerPackets[] = {
+	COMM_SAMPLE_PRINT, COMM_PLOT_INIT, COMM_PLOT_DATA, COMM_PLOT_ADD_GRAPH, COMM_PLOT_SET_GRAPH, COMM_EXPERIMENT_SAMPLE
+};
+
+bool VescSampler::begin(void) {
+	for (uint8_t i = 0; i < sizeof(samplerPackets); i++) {
+		if (!uart.setPacketHandler(samplerPackets[i], handlePacket, this)) {
+			end();
+			return false;
+		}
+	}
+	return true;
+}
+
+void VescSampler::end(void) {
+	for (uint8_t i = 0; i < sizeof(samplerPackets); i++) {
+		uart.setPacketHandler(samplerPackets[i], NULL, NULL);
+	}
+}
+
+bool VescSampler::handlePacket(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t, void * context) {
+	return ((VescSampler *)context)->processPacket(packetId, data, len);
+}
+
+void VescSampler::requestSamples(debug_sampling_mode mode, uint16_t length, uint8_t decimation) {
+	requestSamples(mode, length, decimation, 0);
+}
+
+void VescSampler::requestSamples(debug_sampling_mode mode, uint16_t length, uint8_t decimation, uint8_t canId) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_SAMPLE_PRINT "+String(canId));
+	}
+
+	int32_t index = 0;
+	uint8_t payload[5];
+
+	payload[index++] = { COMM_SAMPLE_PRINT };
+	payload[index++] = mode;
+	buffer_append_uint16(payload, length, &index);
+	payload[index++] = decimation;
+
+	uart.packSendPayload(payload, index, canId);
+}
+
+const VescSampler::sample * VescSampler::getBlock(uint16_t * count) {
+
+	if (readyBlock < 0) {
+		*count = 0;
+		return NULL;
+	}
+
+	*count = blockCount[readyBlock];
+	return blocks[readyBlock];
+}
+
+void VescSampler::releaseBlock(void) {
+
+	if (readyBlock >= 0) {
+		blockCount[readyBlock] = 0;
+		readyBlock = -1;
+	}
+
+	// The other block may have filled up meanwhile; hand it over without waiting for another sample
+	if (blockCount[fillBlock] == VESCSAMPLER_BLOCK_SIZE) {
+		flush();
+	}
+}
+
+bool VescSampler::flush(void) {
+
+	if (readyBlock >= 0 || blockCount[fillBlock] == 0) {
+		return false;
+	}
+
+	readyBlock = fillBlock;
+	fillBlock ^= 1;
+	return true;
+}
+
+bool VescSampler::processPacket(COMM_PACKET_ID packetId, uint8_t * message, int len) {
+
+	int32_t index = 0;
+
+	switch (packetId) {
+		case COMM_PLOT_SET_GRAPH:
+			if (len >= 1) {
+				graph = message[0];
+			}
+			return true;
+
+		case COMM_PLOT_INIT:
+		case COMM_PLOT_ADD_GRAPH:
+			// Only names and labels
+			return true;
+
+		case COMM_SAMPLE_PRINT:
+		case COMM_PLOT_DATA:
+		case COMM_EXPERIMENT_SAMPLE:
+			break;
+
+		default:
+			return false;
+	}
+
+	received++;
+
+	// Swap when the block being filled is full, if the application is done with the other one
+	if (blockCount[fillBlock] == VESCSAMPLER_BLOCK_SIZE) {
+		if (readyBlock >= 0) {
+			dropped++;
+			return true;
+		}
+		readyBlock = fillBlock;
+		fillBlock ^= 1;
+	}
+
+	sample * s = &blocks[fillBlock][blockCount[fillBlock]++];
+	s->source = packetId;
+	s->graph = graph;
+	s->count = 0;
+
+	switch (packetId) {
+		case COMM_SAMPLE_PRINT: // Structure defined here: https://github.com/vedderb/bldc/blob/master/motor/mc_interface.c
+			while (index + 4 <= len - 2 && s->count < 8) {
+				s->values[s->count++] = buffer_get_float32_auto(message, &index);
+			}
+			while (index < len && s->count < VESCSAMPLER_MAX_VALUES) {
+				s->values[s->count++] = message[index++];
+			}
+			break;
+
+		case COMM_PLOT_DATA:
+			while (index + 4 <= len && s->count < 2) {
+				s->values[s->count++] = buffer_get_float32_auto(message, &index);
+			}
+			break;
+
+		default: // COMM_EXPERIMENT_SAMPLE
+			while (index + 4 <= len && s->count < VESCSAMPLER_MAX_VALUES) {
+				s->values[s->count++] = buffer_get_float32(message, 10000.0, &index);
+			}
+			break;
+	}
+
+	// Hand over a full block straight away if the other one is free
+	if (blockCount[fillBlock] == VESCSAMPLER_BLOCK_SIZE && readyBlock < 0) {
+		readyBlock = fillBlock;
+		fillBlock ^= 1;
+	}
+
+	return true;
+}
@@ -0,0 +1,133 @@
+#ifndef _VESCSAMPLER_h
+#define _VESCSAMPLER_h
+
+#include "VescUart.h"
+
+/** Number of samples in each of the two blocks */
+#ifndef VESCSAMPLER_BLOCK_SIZE
+#if defined(__AVR__)
+#define VESCSAMPLER_BLOCK_SIZE 8
+#else
+#define VESCSAMPLER_BLOCK_SIZE 64
+#endif
+#endif
+
+/** Values kept per sample. COMM_SAMPLE_PRINT carries 10, experiment samples can carry more. */
+#ifndef VESCSAMPLER_MAX_VALUES
+#define VESCSAMPLER_MAX_VALUES 10
+#endif
+
+class VescSampler
+{
+	public:
+		/** A single sample streamed by the VESC */
+		struct sample {
+			uint8_t source;		// COMM_SAMPLE_PRINT, COMM_PLOT_DATA or COMM_EXPERIMENT_SAMPLE
+			uint8_t graph;		// Graph selected with COMM_PLOT_SET_GRAPH, for plot data
+			uint8_t count;		// Number of values
+			// COMM_SAMPLE_PRINT: current 1, current 2, phase voltage 1-3, zero voltage,
+			//                    filtered current, switching frequency, status, phase
+			// COMM_PLOT_DATA:    x, y
+			float values[VESCSAMPLER_MAX_VALUES];
+		};
+
+		/**
+		 * @brief      Class constructor
+		 * @param      uart  - The VescUart instance used to talk to the VESC
+		 */
+		VescSampler(VescUart & uart);
+
+		/**
+		 * @brief      Start collecting the samples decoded by VescUart::update()
+		 *
+		 * @return     False if no packet handler of the VescUart instance was free
+		 */
+		bool begin(void);
+
+		/**
+		 * @brief      Stop collecting samples
+		 */
+		void end(void);
+
+		/**
+		 * @brief      Ask the VESC to sample its current and voltage waveforms (COMM_SAMPLE_PRINT)
+		 *
+		 * @param      mode        - When to start sampling and sending, e.g. DEBUG_SAMPLING_NOW
+		 * @param      length      - Number of samples
+		 * @param      decimation  - Keep every n-th sample
+		 */
+		void requestSamples(debug_sampling_mode mode, uint16_t length, uint8_t decimation);
+
+		/**
+		 * @brief      Ask the VESC to sample its current and voltage waveforms (COMM_SAMPLE_PRINT)
+		 *
+		 * @param      mode        - When to start sampling and sending, e.g. DEBUG_SAMPLING_NOW
+		 * @param      length      - Number of samples
+		 * @param      decimation  - Keep every n-th sample
+		 * @param      canId       - The CAN ID of the VESC
+		 */
+		void requestSamples(debug_sampling_mode mode, uint16_t length, uint8_t decimation, uint8_t canId);
+
+		/**
+		 * @brief      Get the block that has been filled. Samples keep filling the other block
+		 *             until releaseBlock() is called.
+		 *
+		 * @param      count  - Set to the number of samples in the block
+		 * @return     Pointer to the samples, or NULL if no block is ready
+		 */
+		const sample * getBlock(uint16_t * count);
+
+		/**
+		 * @brief      Hand the block returned by getBlock() back for filling. If the other block
+		 *             is full, getBlock() returns it next.
+		 */
+		void releaseBlock(void);
+
+		/**
+		 * @brief      Make the partially filled block available to getBlock(), e.g. at the end of a capture
+		 *
+		 * @return     True if there was a block to hand over
+		 */
+		bool flush(void);
+
+		/** Number of samples received */
+		uint32_t received = 0;
+
+		/** Number of samples dropped because both blocks were full */
+		uint32_t dropped = 0;
+
+	private:
+
+		/** Variabel to hold the reference to the VescUart instance */
+		VescUart & uart;
+
+		/** The two blocks: one being filled, one being read */
+		sample blocks[2][VESCSAMPLER_BLOCK_SIZE];
+		uint16_t blockCount[2];
+
+		/** Block being filled */
+		uint8_t fillBlock = 0;
+
+		/** Block handed to the application, or -1 */
+		int8_t readyBlock = -1;
+
+		/** Graph selected with COMM_PLOT_SET_GRAPH */
+		uint8_t graph = 0;
+
+		/**
+		 * @brief      Packet handler registered with VescUart::setPacketHandler(), context is the sampler
+		 */
+		static bool handlePacket(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+
+		/**
+		 * @brief      Stores a sample packet
+		 *
+		 * @param      packetId  - The packet id
+		 * @param      message   - The payload without the packet id
+		 * @param      len       - Length of the payload without the packet id
+		 * @return     True if the packet was a sample packet
+		 */
+		bool processPacket(COMM_PACKET_ID packetId, uint8_t * message, int len);
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "VescTelemetry.h"
+
+// Number of COMM_GET_VALUES fields, i.e. bits of the field mask
+#define FIELD_BITS 22
+
+// Bit of the three per-phase MOSFET temperatures, the only field with several values
+#define FIELD_TEMP_MOSFETS 18
+
+static uint8_t valuesInField(uint8_t bit) {
+	return bit == FIELD_TEMP_MOSFETS ? 3 : 1;
+}
+
+static int putVarint(uint8_t * out, uint32_t value) {
+	int len = 0;
+	while (value >= 0x80) {
+		out[len++] = (uint8_t)value | 0x80;
+		value >>= 7;
+	}
+	out[len++] = (uint8_t)value;
+	return len;
+}
+
+static uint32_t zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void VescTelemetryEncoder::toWire(const VescUart::rawDataPackage & v, int32_t * out) {
+
+	// Undo the rescaling of decodeValueFields(), so deltas are in the steps the VESC sends
+	out[0]  = v.tempMosfet;
+	out[1]  = v.tempMotor;
+	out[2]  = v.avgMotorCurrent / 10;
+	out[3]  = v.avgInputCurrent / 10;
+	out[4]  = v.avgId / 10;
+	out[5]  = v.avgIq / 10;
+	out[6]  = v.dutyCycleNow;
+	out[7]  = v.rpm;
+	out[8]  = v.inpVoltage / 100;
+	out[9]  = v.ampHours;
+	out[10] = v.ampHoursCharged;
+	out[11] = v.wattHours;
+	out[12] = v.wattHoursCharged;
+	out[13] = v.tachometer;
+	out[14] = v.tachometerAbs;
+	out[15] = v.error;
+	out[16] = v.pidPos;
+	out[17] = v.id;
+	out[18] = v.tempMosfet1;
+	out[19] = v.tempMosfet2;
+	out[20] = v.tempMosfet3;
+	out[21] = v.avgVd;
+	out[22] = v.avgVq;
+	out[23] = v.status;
+}
+
+void VescTelemetryEncoder::fromWire(const int32_t * in, uint32_t fields, VescUart::rawDataPackage & v) {
+	v.tempMosfet		= in[0];
+	v.tempMotor			= in[1];
+	v.avgMotorCurrent	= in[2] * 10;
+	v.avgInputCurrent	= in[3] * 10;
+	v.avgId				= in[4] * 10;
+	v.avgIq				= in[5] * 10;
+	v.dutyCycleNow		= in[6];
+	v.rpm				= in[7];
+	v.inpVoltage		= in[8] * 100;
+	v.ampHours			= in[9];
+	v.ampHoursCharged	= in[10];
+	v.wattHours			= in[11];
+	v.wattHoursCharged	= in[12];
+	v.tachometer		= in[13];
+	v.tachometerAbs		= in[14];
+	v.error				= (mc_fault_code)in[15];
+	v.pidPos			= in[16];
+	v.id				= in[17];
+	v.tempMosfet1		= in[18];
+	v.tempMosfet2		= in[19];
+	v.tempMosfet3		= in[20];
+	v.avgVd				= in[21];
+	v.avgVq				= in[22];
+	v.status			= in[23];
+	v.fields			= fields;
+}
+
+VescTelemetryEncoder::VescTelemetryEncoder(void) {
+	memset(previous, 0, sizeof(previous));
+}
+
+int VescTelemetryEncoder::encode(const VescUart::rawDataPackage & values, uint32_t time_ms) {
+
+	// Worst case: two 5 byte varints for the header and time, and 5 bytes per value
+	uint8_t record[10 + 5 * VESCTELEMETRY_MAX_VALUES];
+	int32_t sample[VESCTELEMETRY_MAX_VALUES];
+	int len = 0;
+
+	uint32_t fields = values.fields & VALUES_MASK_ALL;
+	toWire(values, sample);
+
+	bool key = needKeyframe || used == 0 || fields != previousFields || sinceKeyframe >= VESCTELEMETRY_KEYFRAME_INTERVAL;
+
+	if (key) {
+		len += putVarint(record + len, fields << 1);
+		len += putVarint(record + len, time_ms);
+	} else {
+		uint32_t changed = 0;
+		for (uint8_t bit = 0, slot = 0; bit < FIELD_BITS; slot += valuesInField(bit), bit++) {
+			for (uint8_t i = 0; i < valuesInField(bit); i++) {
+				if ((fields & ((uint32_t)1 << bit)) && sample[slot + i] != previous[slot + i]) {
+					changed |= (uint32_t)1 << bit;
+				}
+			}
+		}
+		len += putVarint(record + len, changed << 1 | 1);
+		len += putVarint(record + len, time_ms - previousTime);
+		fields = changed;
+	}
+
+	for (uint8_t bit = 0, slot = 0; bit < FIELD_BITS; slot += valuesInField(bit), bit++) {
+		if (!(fields & ((uint32_t)1 << bit))) {
+			continue;
+		}
+		for (uint8_t i = 0; i < valuesInField(bit); i++) {
+			// Wrapping difference, the decoder wraps the same way
+			int32_t value = key ? sample[slot + i] : (int32_t)((uint32_t)sample[slot + i] - (uint32_t)previous[slot + i]);
+			len += putVarint(record + len, zigzag(value));
+		}
+	}
+
+	if (used + len > VESCTELEMETRY_BUFFER_SIZE) {
+		return 0;
+	}
+
+	memcpy(buffer + used, record, len);
+	used += len;
+
+	memcpy(previous, sample, sizeof(previous));
+	previousTime = time_ms;
+	if (key) {
+		previousFields = values.fields & VALUES_MASK_ALL;
+		sinceKeyframe = 0;
+		needKeyframe = false;
+	}
+	sinceKeyframe++;
+
+	samples++;
+	bytes += len;
+	return len;
+}
+
+void VescTelemetryEncoder::reset(void) {
+	used = 0;
+	needKeyframe = true;
+}
+
+void VescTelemetryEncoder::keyframe(void) {
+	needKeyframe = true;
+}
+
+VescTelemetryDecoder::VescTelemetryDecoder(void) {
+	memset(&values, 0, sizeof(values));
+	memset(current, 0, sizeof(current));
+}
+
+void VescTelemetryDecoder::begin(const uint8_t * data, uint16_t len) {
+	input = data;
+	inputLen = len;
+	position = 0;
+}
+
+bool VescTelemetryDecoder::next(void) {
+
+	uint32_t header;
+	uint32_t time;
+
+	if (position >= inputLen) {
+		return false;
+	}
+
+	if (!readVarint(&header) || !readVarint(&time)) {
+		errors++;
+		position = inputLen;
+		return false;
+	}
+
+	bool key = !(header & 1);
+	uint32_t fields = header >> 1;
+
+	if (!key && !synced) {
+		// Nothing to add the differences to, wait for the next keyframe
+		errors++;
+		position = inputLen;
+		return false;
+	}
+
+	for (uint8_t bit = 0, slot = 0; bit < FIELD_BITS; slot += valuesInField(bit), bit++) {
+		if (!(fields & ((uint32_t)1 << bit))) {
+			continue;
+		}
+		for (uint8_t i = 0; i < valuesInField(bit); i++) {
+			uint32_t value;
+			if (!readVarint(&value)) {
+				errors++;
+				synced = false;
+				position = inputLen;
+				return false;
+			}
+			current[slot + i] = key ? unzigzag(value) : (int32_t)((uint32_t)current[slot + i] + (uint32_t)unzigzag(value));
+		}
+	}
+
+	if (key) {
+		currentFields = fields;
+		time_ms = time;
+		synced = true;
+	} else {
+		time_ms += time;
+	}
+
+	VescTelemetryEncoder::fromWire(current, currentFields, values);
+	return true;
+}
+
+bool VescTelemetryDecoder::readVarint(uint32_t * value) {
+
+	*value = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7) {
+		if (position >= inputLen) {
+			return false;
+		}
+		uint8_t byte = input[position++];
+		*value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
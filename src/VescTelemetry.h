@@ -0,0 +1,129 @@
+#ifndef _VESCTELEMETRY_h
+#define _VESCTELEMETRY_h
+
+#include "VescUart.h"
+
+/** Size of the encoder output buffer */
+#ifndef VESCTELEMETRY_BUFFER_SIZE
+#if defined(__AVR__)
+#define VESCTELEMETRY_BUFFER_SIZE 64
+#else
+#define VESCTELEMETRY_BUFFER_SIZE 512
+#endif
+#endif
+
+/** Samples between keyframes when the buffer is not reset in between */
+#ifndef VESCTELEMETRY_KEYFRAME_INTERVAL
+#define VESCTELEMETRY_KEYFRAME_INTERVAL 32
+#endif
+
+/** Number of values in a sample: the COMM_GET_VALUES fields, with the three MOSFET temperatures */
+#define VESCTELEMETRY_MAX_VALUES 24
+
+/*
+	Compact telemetry records for slow links and storage. Values are kept in the integer units
+	the VESC sends them in. A keyframe holds every field of a sample; the samples that follow
+	only hold the fields that changed, as the difference to the previous sample. Numbers are
+	zigzag varints: small differences of either sign take a single byte.
+
+	Keyframe: varint(fields << 1),       varint(time_ms), zigzag(value) for each field
+	Delta:    varint(changed << 1 | 1),  varint(dt_ms),   zigzag(value - previous) for each changed field
+*/
+
+class VescTelemetryEncoder
+{
+	public:
+
+		VescTelemetryEncoder(void);
+
+		/**
+		 * @brief      Appends a sample to the buffer
+		 * @param      values   - The sample, e.g. VescUart::dataRaw after update()
+		 * @param      time_ms  - Time of the sample, e.g. millis()
+		 * @return     Number of bytes appended, 0 if the buffer is full and must be sent and reset first
+		 */
+		int encode(const VescUart::rawDataPackage & values, uint32_t time_ms);
+
+		/** @return The encoded samples */
+		const uint8_t * data(void) { return buffer; }
+
+		/** @return Number of bytes in the buffer */
+		uint16_t length(void) { return used; }
+
+		/**
+		 * @brief      Empties the buffer. It starts with a keyframe again, so every buffer can be
+		 *             decoded on its own.
+		 */
+		void reset(void);
+
+		/**
+		 * @brief      Makes the next sample a keyframe
+		 */
+		void keyframe(void);
+
+		/** Samples and bytes encoded since construction */
+		uint32_t samples = 0;
+		uint32_t bytes = 0;
+
+	private:
+
+		uint8_t buffer[VESCTELEMETRY_BUFFER_SIZE];
+		uint16_t used = 0;
+
+		/** The previous sample, in wire units */
+		int32_t previous[VESCTELEMETRY_MAX_VALUES];
+		uint32_t previousFields = 0;
+		uint32_t previousTime = 0;
+		uint16_t sinceKeyframe = 0;
+		bool needKeyframe = true;
+
+		friend class VescTelemetryDecoder;
+
+		/** Conversion between dataRaw and the values of a sample, in field mask order */
+		static void toWire(const VescUart::rawDataPackage & v, int32_t * out);
+		static void fromWire(const int32_t * in, uint32_t fields, VescUart::rawDataPackage & v);
+};
+
+class VescTelemetryDecoder
+{
+	public:
+
+		VescTelemetryDecoder(void);
+
+		/**
+		 * @brief      Sets the bytes to decode, e.g. a buffer from VescTelemetryEncoder. The previous
+		 *             sample is kept, so a stream may be split anywhere between records.
+		 * @param      data  - The encoded samples
+		 * @param      len   - Number of bytes
+		 */
+		void begin(const uint8_t * data, uint16_t len);
+
+		/**
+		 * @brief      Decodes the next sample into values and time_ms
+		 * @return     True if a sample was decoded, false at the end of the data or on an error
+		 */
+		bool next(void);
+
+		/** The last decoded sample, in the units of VescUart::dataRaw */
+		VescUart::rawDataPackage values;
+
+		/** Time of the last decoded sample */
+		uint32_t time_ms = 0;
+
+		/** Number of malformed records, or deltas without a keyframe before them */
+		uint32_t errors = 0;
+
+	private:
+
+		const uint8_t * input = NULL;
+		uint16_t inputLen = 0;
+		uint16_t position = 0;
+
+		int32_t current[VESCTELEMETRY_MAX_VALUES];
+		uint32_t currentFields = 0;
+		bool synced = false;
+
+		bool readVarint(uint32_t * value);
+};
+
+#endif
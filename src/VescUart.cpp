@@ -1,230 +1,1274 @@
 #include <stdint.h>
 #include "VescUart.h"
 
+// Size in bytes of each field of the COMM_GET_VALUES reply, indexed by its bit in the
+// COMM_GET_VALUES_SELECTIVE mask. Structure defined here: https://github.com/vedderb/bldc/blob/master/comm/commands.c
+static const uint8_t valuesFieldSize[] = {
+	2, 2, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, 4, 1,	// temp_fet ... fault
+	4, 1,											// pid_pos, controller_id
+	6, 4, 4, 1										// temp_mos1-3, vd, vq, status
+};
+
+// Fields each layout must contain, and fields it may contain, as COMM_GET_VALUES_SELECTIVE masks
+static const uint32_t valuesLayoutRequired[] = { 0x0001FFFF, 0x0000FFFF, 0x0003FFFF, 0x0003FFFF };
+static const uint32_t valuesLayoutMax[]      = { 0x003FFFFF, 0x0000FFFF, 0x0003FFFF, 0x003FFFFF };
+
 VescUart::VescUart(uint32_t timeout_ms) : _TIMEOUT(timeout_ms) {
 	nunchuck.valueX         = 127;
 	nunchuck.valueY         = 127;
 	nunchuck.lowerButton  	= false;
 	nunchuck.upperButton  	= false;
+
+	memset(&dataRaw, 0, sizeof(dataRaw));
+	memset(&dataExtended, 0, sizeof(dataExtended));
+	memset(&imu, 0, sizeof(imu));
+	clearFWcache();
+
+	memset(pending, 0, sizeof(pending));
+	memset(handlerIndex, 0, sizeof(handlerIndex));
+	memset(handlers, 0, sizeof(handlers));
+	setPacketHandler(COMM_PRINT, handlePrint, this);
+	setPacketHandler(COMM_LISP_PRINT, handlePrint, this);
+}
+
+void VescUart::setSerialPort(Stream* port)
+{
+	serialPort = port;
+}
+
+void VescUart::setDebugPort(Stream* port)
+{
+	debugPort = port;
+}
+
+void VescUart::setBaudRate(uint32_t baud)
+{
+	// 10 bits per byte with 8N1, in ns so that fast links keep their precision
+	rxByteTime_ns = baud > 0 ? 1000000000UL / baud * 10 : 0;
+}
+
+int VescUart::waitForPacket(uint8_t packetId, uint8_t canId, uint32_t timeout_ms) {
+
+	if (serialPort == NULL)
+		return -1;
+
+	uint32_t start = millis();
+
+	while (millis() - start < timeout_ms) {
+		int lenPayload = pollUartMessage();
+		if (lenPayload <= 0) {
+			continue;
+		}
+
+		if (rxBuffer[0] == packetId) {
+			if (isReplyFrom(canId, lenPayload)) {
+				return lenPayload;
+			}
+		}
+
+		// Unsolicited packets, late replies to non-blocking requests and replies from other
+		// controllers go to their handlers
+		processReadPacket(rxBuffer, lenPayload, replySender(rxBuffer, lenPayload));
+	}
+
+	if( debugPort != NULL ) {
+		debugPort->println("Timeout");
+	}
+	return 0;
+}
+
+bool VescUart::isReplyFrom(uint8_t canId, int len) {
+
+	int index = replyIdIndex(rxBuffer, len);
+	if (index < 0) {
+		return true;
+	}
+
+	// The id of the local controller is not known, but it is none of the CAN controllers
+	if (canId == 0) {
+		return !isCanController(rxBuffer[index]);
+	}
+
+	valuesLayout layout = getValuesLayout(canId);
+	if (rxBuffer[0] == COMM_GET_VALUES && layout != VALUES_LAYOUT_FW3 && layout != VALUES_LAYOUT_FW5) {
+		return true;
+	}
+	return rxBuffer[index] == canId;
+}
+
+int VescUart::replyIdIndex(uint8_t * message, int len) {
+
+	int index = -1;
+
+	// The controller id follows the first 57 bytes of fields on firmware 3 and newer
+	if (message[0] == COMM_GET_VALUES && len >= 59) {
+		index = 58;
+	} else if (message[0] == COMM_GET_VALUES_SELECTIVE && len >= 5) {
+		int32_t ind = 1;
+		uint32_t mask = buffer_get_uint32(message, &ind);
+		if (mask & VALUES_MASK_CONTROLLER_ID) {
+			index = 5;
+			for (uint8_t bit = 0; bit < 17; bit++) {
+				if (mask & ((uint32_t)1 << bit)) {
+					index += valuesFieldSize[bit];
+				}
+			}
+		}
+	}
+
+	return index < len ? index : -1;
+}
+
+bool VescUart::isCanController(uint8_t id) {
+
+	// 0 is the CAN ID used for the controller on the UART
+	if (id == 0) {
+		return false;
+	}
+
+	// A values request to it is waiting, or it was asked for its firmware, which may have been
+	// evicted from the cache since
+	for (int i = 0; i < VESCUART_MAX_PENDING; i++) {
+		pendingRequest * p = &pending[i];
+		if (p->used && p->canId == id && rxStart_us - p->sent_us <= _TIMEOUT * 1000) {
+			return true;
+		}
+	}
+	return findFWcacheEntry(id, false) != NULL;
+}
+
+uint8_t VescUart::replySender(uint8_t * message, int len) {
+
+	int index = replyIdIndex(message, len);
+	if (index >= 0) {
+		uint8_t id = message[index];
+		return isCanController(id) ? id : 0;
+	}
+
+	// Without an id, the reply answers the oldest values request that is still waiting
+	if (message[0] == COMM_GET_VALUES || message[0] == COMM_GET_VALUES_SELECTIVE) {
+		pendingRequest * oldest = NULL;
+		for (int i = 0; i < VESCUART_MAX_PENDING; i++) {
+			pendingRequest * p = &pending[i];
+			if (!p->used || rxStart_us - p->sent_us > _TIMEOUT * 1000) {
+				continue;
+			}
+			if (oldest == NULL || (int32_t)(p->sent_us - oldest->sent_us) < 0) {
+				oldest = p;
+			}
+		}
+		if (oldest != NULL) {
+			return oldest->canId;
+		}
+	}
+	return requestCanId;
+}
+
+int VescUart::pollUartMessage(void) {
+
+	// Messages <= 255 starts with "2", 2nd byte is length
+	// Messages > 255 starts with "3" 2nd and 3rd byte is length combined with 1st >>8 and then &0xFF
+	// The payload is followed by the CRC-16 (2 bytes) and the stop byte "3"
+
+	if (serialPort == NULL)
+		return -1;
+
+	while (serialPort->available()) {
+
+		uint8_t byte = serialPort->read();
+
+		if (rxCounter == 0) {
+			switch (byte)
+			{
+				case 2:
+					rxHeaderLen = 2;
+				break;
+
+				case 3:
+					rxHeaderLen = 3;
+				break;
+
+				default:
+					if( debugPort != NULL ){
+						debugPort->println("Unvalid start bit");
+					}
+					continue; // Wait for the next start byte
+			}
+			// The bytes already waiting behind the start byte arrived after it, so with the baud
+			// rate known the start byte is back-dated by their transfer time
+			rxStart_us = micros();
+			if (rxByteTime_ns > 0) {
+				rxStart_us -= (uint32_t)serialPort->available() * rxByteTime_ns / 1000;
+			}
+			rxLenPayload = 0;
+			rxCounter++;
+			continue;
+		}
+
+		if (rxCounter < rxHeaderLen) {
+			rxLenPayload = (rxLenPayload << 8) | byte;
+			rxCounter++;
+
+			if (rxCounter == rxHeaderLen && rxLenPayload > VESCUART_RX_BUFFER_SIZE) {
+				if( debugPort != NULL ){
+					debugPort->println("Message is larger than the receive buffer");
+				}
+				rxCounter = 0;
+			}
+			continue;
+		}
+
+		if (rxCounter < rxHeaderLen + rxLenPayload) {
+			rxBuffer[rxCounter - rxHeaderLen] = byte;
+		} else {
+			rxFooter[rxCounter - rxHeaderLen - rxLenPayload] = byte;
+		}
+		rxCounter++;
+
+		if (rxCounter == rxHeaderLen + rxLenPayload + 3) { // Payload + 2 for CRC + 1 for stop byte
+			rxCounter = 0;
+
+			if (rxFooter[2] != 3) {
+				if( debugPort != NULL ){
+					debugPort->println("Unvalid stop bit");
+				}
+				continue;
+			}
+			if (debugPort != NULL) {
+				debugPort->println("End of message reached!");
+			}
+			// Return as soon as a message is complete, even if there is still more data in the buffer.
+			if (unpackPayload(rxBuffer, rxLenPayload, rxFooter)) {
+				return rxLenPayload;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int VescUart::update(void) {
+
+	int count = 0;
+	int lenPayload;
+
+	while ((lenPayload = pollUartMessage()) > 0) {
+		if (processReadPacket(rxBuffer, lenPayload, replySender(rxBuffer, lenPayload))) {
+			count++;
+		}
+	}
+	return count;
+}
+
+
+bool VescUart::unpackPayload(uint8_t * payload, int lenPay, uint8_t * footer) {
+
+	uint16_t crcMessage = 0;
+	uint16_t crcPayload = 0;
+
+	// Rebuild crc:
+	crcMessage = footer[0] << 8;
+	crcMessage &= 0xFF00;
+	crcMessage += footer[1];
+
+	if(debugPort!=NULL){
+		debugPort->print("SRC received: "); debugPort->println(crcMessage);
+	}
+
+	crcPayload = crc16(payload, lenPay);
+
+	if( debugPort != NULL ){
+		debugPort->print("SRC calc: "); debugPort->println(crcPayload);
+	}
+	
+	if (crcPayload == crcMessage) {
+		if( debugPort != NULL ) {
+			debugPort->print("Payload :      ");
+			serialPrint(payload, lenPay - 1); debugPort->println();
+		}
+
+		return true;
+	}else{
+		return false;
+	}
+}
+
+
+int VescUart::packSendPayload(uint8_t * payload, int lenPay) {
+	return packSendPayload(payload, lenPay, 0);
+}
+
+int VescUart::packSendPayload(uint8_t * payload, int lenPay, uint8_t canId) {
+	return packSendPacket(payload[0], payload + 1, lenPay - 1, canId);
+}
+
+int VescUart::packSendPacket(uint8_t packetId, const uint8_t * data, int len, uint8_t canId) {
+
+	uint8_t header[6];
+	uint8_t footer[3];
+	int count = 0;
+	int lenTotal = 1 + len + (canId == 0 ? 0 : 2);
+	
+	if (lenTotal <= 255)
+	{
+		header[count++] = 2;
+		header[count++] = lenTotal;
+	}
+	else
+	{
+		header[count++] = 3;
+		header[count++] = (uint8_t)(lenTotal >> 8);
+		header[count++] = (uint8_t)(lenTotal & 0xFF);
+	}
+
+	// Forward header and packet id are part of the payload and covered by the CRC
+	int lenPrefix = 1;
+	if (canId != 0) {
+		header[count++] = { COMM_FORWARD_CAN };
+		header[count++] = canId;
+		lenPrefix += 2;
+	}
+	header[count++] = packetId;
+
+	uint16_t crcPayload = crc16_continue(crc16(header + count - lenPrefix, lenPrefix), (unsigned char *)data, len);
+
+	footer[0] = (uint8_t)(crcPayload >> 8);
+	footer[1] = (uint8_t)(crcPayload & 0xFF);
+	footer[2] = 3;
+	
+	if(debugPort!=NULL){
+		debugPort->print("Package to send: "); serialPrint(header, count - 1); serialPrint((uint8_t *)data, len - 1); serialPrint(footer, 2);
+	}
+
+	// Sending package
+	if( serialPort != NULL ) {
+		serialPort->write(header, count);
+		serialPort->write(data, len);
+		serialPort->write(footer, 3);
+	}
+
+	// Returns number of send bytes
+	return count + len + 3;
+}
+
+
+bool VescUart::processReadPacket(uint8_t * message, int len, uint8_t canId) {
+
+	uint8_t packetId = message[0];
+
+	if (packetId >= VESCUART_PACKET_ID_COUNT || handlerIndex[packetId] == 0) {
+		return false;
+	}
+
+	// Removes the packetId from the actual message (payload)
+	handlerEntry * entry = &handlers[handlerIndex[packetId] - 1];
+	return entry->handler((COMM_PACKET_ID)packetId, message + 1, len - 1, canId, entry->context);
+}
+
+bool VescUart::setPacketHandler(uint8_t packetId, packetHandler handler, void * context) {
+
+	if (packetId >= VESCUART_PACKET_ID_COUNT) {
+		return false;
+	}
+
+	uint8_t current = handlerIndex[packetId];
+	uint8_t index = 0;
+
+	if (handler != NULL) {
+		// Share the entry of another packet id with the same handler and context, e.g.
+		// COMM_PRINT and COMM_LISP_PRINT, or the packets of VescSampler
+		for (uint8_t i = 0; i < VESCUART_MAX_HANDLERS && index == 0; i++) {
+			if (handlers[i].users > 0 && handlers[i].handler == handler && handlers[i].context == context) {
+				index = i + 1;
+			}
+		}
+		// Otherwise replace the entry of this packet id if it is its own, or take a free one
+		if (index == 0 && current != 0 && handlers[current - 1].users == 1) {
+			index = current;
+		}
+		for (uint8_t i = 0; i < VESCUART_MAX_HANDLERS && index == 0; i++) {
+			if (handlers[i].users == 0) {
+				index = i + 1;
+			}
+		}
+		if (index == 0) {
+			if (debugPort != NULL) {
+				debugPort->println("No free packet handler");
+			}
+			return false;
+		}
+	}
+
+	if (index == current) {
+		if (index != 0) {
+			handlers[index - 1].handler = handler;
+			handlers[index - 1].context = context;
+		}
+		return true;
+	}
+
+	if (current != 0) {
+		handlers[current - 1].users--;
+	}
+	if (index != 0) {
+		handlers[index - 1].handler = handler;
+		handlers[index - 1].context = context;
+		handlers[index - 1].users++;
+	}
+	handlerIndex[packetId] = index;
+	return true;
+}
+
+bool VescUart::handleFWversion(COMM_PACKET_ID, uint8_t * data, int len, uint8_t canId, void * context) {
+	return ((VescUart *)context)->decodeFWversion(data, len, canId);
+}
+
+bool VescUart::handleValues(COMM_PACKET_ID, uint8_t * data, int len, uint8_t canId, void * context) {
+	VescUart * vesc = (VescUart *)context;
+	if (!vesc->decodeValues(data, len, vesc->getValuesLayout(canId))) {
+		return false;
+	}
+	vesc->stampValues(canId);
+	if (vesc->valuesCallback != NULL) {
+		vesc->valuesCallback(canId, vesc->valuesContext);
+	}
+	return true;
+}
+
+bool VescUart::handleValuesSelective(COMM_PACKET_ID, uint8_t * data, int len, uint8_t canId, void * context) {
+	VescUart * vesc = (VescUart *)context;
+	if (!vesc->decodeValuesSelective(data, len)) {
+		return false;
+	}
+	vesc->stampValues(canId);
+	if (vesc->valuesCallback != NULL) {
+		vesc->valuesCallback(canId, vesc->valuesContext);
+	}
+	return true;
+}
+
+void VescUart::addPending(uint8_t canId) {
+
+	// Take a free entry, or the oldest one: its reply is the most likely to be lost
+	pendingRequest * p = &pending[0];
+	for (int i = 0; i < VESCUART_MAX_PENDING; i++) {
+		if (!pending[i].used) {
+			p = &pending[i];
+			break;
+		}
+		if ((int32_t)(pending[i].sent_us - p->sent_us) < 0) {
+			p = &pending[i];
+		}
+	}
+
+	p->used = true;
+	p->canId = canId;
+	p->sent_us = micros();
+}
+
+void VescUart::stampValues(uint8_t canId) {
+
+	// The VESC answers in order, so the reply belongs to the oldest request to canId. Requests
+	// older than the timeout lost their reply.
+	pendingRequest * oldest = NULL;
+	for (int i = 0; i < VESCUART_MAX_PENDING; i++) {
+		pendingRequest * p = &pending[i];
+		if (!p->used || p->canId != canId) {
+			continue;
+		}
+		if (rxStart_us - p->sent_us > _TIMEOUT * 1000) {
+			p->used = false;
+			continue;
+		}
+		if (oldest == NULL || (int32_t)(p->sent_us - oldest->sent_us) < 0) {
+			oldest = p;
+		}
+	}
+
+	dataRaw.rxTime_us = rxStart_us;
+	dataRaw.txTime_us = 0;
+	if (oldest != NULL) {
+		dataRaw.txTime_us = oldest->sent_us;
+		oldest->used = false;
+	}
+}
+
+bool VescUart::handleImuData(COMM_PACKET_ID, uint8_t * data, int len, uint8_t, void * context) {
+	return ((VescUart *)context)->decodeImuData(data, len);
+}
+
+bool VescUart::handleBmsValues(COMM_PACKET_ID, uint8_t * data, int len, uint8_t, void * context) {
+	return ((VescUart *)context)->decodeBmsValues(data, len);
+}
+
+bool VescUart::handleLispStats(COMM_PACKET_ID, uint8_t * data, int len, uint8_t, void * context) {
+	return ((VescUart *)context)->decodeLispStats(data, len);
+}
+
+bool VescUart::handleStats(COMM_PACKET_ID, uint8_t * data, int len, uint8_t, void * context) {
+	return ((VescUart *)context)->decodeStats(data, len);
+}
+
+bool VescUart::handleCustomAppData(COMM_PACKET_ID, uint8_t * data, int len, uint8_t, void * context) {
+	VescUart * vesc = (VescUart *)context;
+	vesc->customAppDataCallback(data, len, vesc->customAppDataContext);
+	return true;
+}
+
+bool VescUart::handlePrint(COMM_PACKET_ID, uint8_t * data, int len, uint8_t, void * context) {
+
+	VescUart * vesc = (VescUart *)context;
+
+	for (int i = 0; i < len; i++) {
+		uint16_t next = (vesc->printHead + 1) % VESCUART_PRINT_BUFFER_SIZE;
+		if (next == vesc->printTail) {
+			vesc->printDropped += len - i;
+			break;
+		}
+		vesc->printBuffer[vesc->printHead] = data[i];
+		vesc->printHead = next;
+	}
+	return true;
+}
+
+bool VescUart::decodeFWversion(uint8_t * message, int len, uint8_t canId) {
+
+	// Structure defined here: https://github.com/vedderb/bldc/blob/master/comm/commands.c
+	int32_t index = 0;
+
+	if (len < 2) {
+		return false;
+	}
+
+	memset(&fw_version, 0, sizeof(fw_version));
+	fw_version.major = message[index++];
+	fw_version.minor = message[index++];
+
+	// Null-terminated hardware name, followed by the 12 byte STM32 UUID
+	int nameLen = 0;
+	while (index < len && message[index] != 0) {
+		if (nameLen < VESCUART_HW_NAME_LEN - 1) {
+			fw_version.hwName[nameLen++] = message[index];
+		}
+		index++;
+	}
+	index++; // Skip terminator
+
+	if (index + 12 <= len) {
+		memcpy(fw_version.uuid, &message[index], 12);
+		index += 12;
+	}
+	if (index + 3 <= len) {
+		fw_version.pairingDone	= message[index++];
+		fw_version.testVersion	= message[index++];
+		fw_version.hwType		= (HW_TYPE)message[index++];
+	}
+
+	// Not cached when the cache is full; the values of the controller are then decoded by the
+	// length of the reply
+	FWcacheEntry * entry = findFWcacheEntry(canId, true);
+	if (entry == NULL) {
+		return true;
+	}
+	entry->known = true;
+	entry->fw = fw_version;
+	if (fw_version.major >= 5) {
+		entry->layout = VALUES_LAYOUT_FW5;
+	} else if (fw_version.major >= 3) {
+		entry->layout = VALUES_LAYOUT_FW3;
+	} else {
+		entry->layout = VALUES_LAYOUT_FW2;
+	}
+	return true;
+}
+
+bool VescUart::decodeValues(uint8_t * message, int len, valuesLayout layout) {
+
+	// Find the fields of the layout that are actually present in the reply. Newer firmware
+	// appends fields, so anything beyond the layout is ignored.
+	uint32_t mask = 0;
+	int size = 0;
+	for (uint8_t bit = 0; bit < sizeof(valuesFieldSize); bit++) {
+		if (!(valuesLayoutMax[layout] & ((uint32_t)1 << bit))) {
+			continue;
+		}
+		if (size + valuesFieldSize[bit] > len) {
+			break;
+		}
+		size += valuesFieldSize[bit];
+		mask |= (uint32_t)1 << bit;
+	}
+
+	if ((mask & valuesLayoutRequired[layout]) != valuesLayoutRequired[layout]) {
+		if (debugPort != NULL) {
+			debugPort->println("COMM_GET_VALUES reply too short for firmware layout");
+		}
+		return false;
+	}
+
+	decodeValueFields(message, mask);
+	return true;
+}
+
+bool VescUart::decodeValuesSelective(uint8_t * message, int len) {
+
+	// [uint32 mask][the fields selected by the mask, in the order of COMM_GET_VALUES]
+	int32_t index = 0;
+
+	if (len < 4) {
+		return false;
+	}
+
+	uint32_t mask = buffer_get_uint32(message, &index) & VALUES_MASK_ALL;
+	if (4 + valuesSize(mask) > len) {
+		if (debugPort != NULL) {
+			debugPort->println("COMM_GET_VALUES_SELECTIVE reply too short for its mask");
+		}
+		return false;
+	}
+
+	decodeValueFields(message + 4, mask);
+	return true;
+}
+
+void VescUart::decodeValueFields(uint8_t * message, uint32_t mask) {
+
+	int32_t index = 0;
+
+	// Only integer operations here; the wire units are rescaled to mA/mV where that is a plain multiply
+	if (mask & ((uint32_t)1 << 0))	dataRaw.tempMosfet			= buffer_get_int16(message, &index);			// 2 bytes - mc_interface_temp_fet_filtered()
+	if (mask & ((uint32_t)1 << 1))	dataRaw.tempMotor			= buffer_get_int16(message, &index);			// 2 bytes - mc_interface_temp_motor_filtered()
+	if (mask & ((uint32_t)1 << 2))	dataRaw.avgMotorCurrent		= buffer_get_int32(message, &index) * 10;	// 4 bytes - mc_interface_read_reset_avg_motor_current()
+	if (mask & ((uint32_t)1 << 3))	dataRaw.avgInputCurrent		= buffer_get_int32(message, &index) * 10;	// 4 bytes - mc_interface_read_reset_avg_input_current()
+	if (mask & ((uint32_t)1 << 4))	dataRaw.avgId				= buffer_get_int32(message, &index) * 10;	// 4 bytes - mc_interface_read_reset_avg_id()
+	if (mask & ((uint32_t)1 << 5))	dataRaw.avgIq				= buffer_get_int32(message, &index) * 10;	// 4 bytes - mc_interface_read_reset_avg_iq()
+	if (mask & ((uint32_t)1 << 6))	dataRaw.dutyCycleNow		= buffer_get_int16(message, &index);			// 2 bytes - mc_interface_get_duty_cycle_now()
+	if (mask & ((uint32_t)1 << 7))	dataRaw.rpm					= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_rpm()
+	if (mask & ((uint32_t)1 << 8))	dataRaw.inpVoltage			= (int32_t)buffer_get_int16(message, &index) * 100;	// 2 bytes - GET_INPUT_VOLTAGE()
+	if (mask & ((uint32_t)1 << 9))	dataRaw.ampHours			= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_amp_hours(false)
+	if (mask & ((uint32_t)1 << 10))	dataRaw.ampHoursCharged		= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_amp_hours_charged(false)
+	if (mask & ((uint32_t)1 << 11))	dataRaw.wattHours			= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_watt_hours(false)
+	if (mask & ((uint32_t)1 << 12))	dataRaw.wattHoursCharged	= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_watt_hours_charged(false)
+	if (mask & ((uint32_t)1 << 13))	dataRaw.tachometer			= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_tachometer_value(false)
+	if (mask & ((uint32_t)1 << 14))	dataRaw.tachometerAbs		= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_tachometer_abs_value(false)
+	if (mask & ((uint32_t)1 << 15))	dataRaw.error				= (mc_fault_code)message[index++];			// 1 byte  - mc_interface_get_fault()
+	if (mask & ((uint32_t)1 << 16))	dataRaw.pidPos				= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_get_pid_pos_now()
+	if (mask & ((uint32_t)1 << 17))	dataRaw.id					= message[index++];							// 1 byte  - app_get_configuration()->controller_id
+	if (mask & ((uint32_t)1 << 18)) {
+		dataRaw.tempMosfet1	= buffer_get_int16(message, &index);										// 2 bytes - NTC_TEMP_MOS1()
+		dataRaw.tempMosfet2	= buffer_get_int16(message, &index);										// 2 bytes - NTC_TEMP_MOS2()
+		dataRaw.tempMosfet3	= buffer_get_int16(message, &index);										// 2 bytes - NTC_TEMP_MOS3()
+	}
+	if (mask & ((uint32_t)1 << 19))	dataRaw.avgVd				= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_read_reset_avg_vd()
+	if (mask & ((uint32_t)1 << 20))	dataRaw.avgVq				= buffer_get_int32(message, &index);			// 4 bytes - mc_interface_read_reset_avg_vq()
+	if (mask & ((uint32_t)1 << 21))	dataRaw.status				= message[index++];							// 1 byte  - timeout_has_timeout() | timeout_kill_sw_active() << 1
+
+	dataRaw.fields = mask;
+}
+
+int VescUart::valuesSize(uint32_t mask) {
+
+	int size = 0;
+	for (uint8_t bit = 0; bit < sizeof(valuesFieldSize); bit++) {
+		if (mask & ((uint32_t)1 << bit)) {
+			size += valuesFieldSize[bit];
+		}
+	}
+	return size;
+}
+
+void VescUart::convertRawValues(void) {
+
+	uint32_t mask = dataRaw.fields;
+
+	if (mask & ((uint32_t)1 << 0))	data.tempMosfet 		= (float)dataRaw.tempMosfet / 10.0f;
+	if (mask & ((uint32_t)1 << 1))	data.tempMotor 			= (float)dataRaw.tempMotor / 10.0f;
+	if (mask & ((uint32_t)1 << 2))	data.avgMotorCurrent 	= (float)dataRaw.avgMotorCurrent / 1000.0f;
+	if (mask & ((uint32_t)1 << 3))	data.avgInputCurrent 	= (float)dataRaw.avgInputCurrent / 1000.0f;
+	if (mask & ((uint32_t)1 << 4))	dataExtended.avgId		= (float)dataRaw.avgId / 1000.0f;
+	if (mask & ((uint32_t)1 << 5))	dataExtended.avgIq		= (float)dataRaw.avgIq / 1000.0f;
+	if (mask & ((uint32_t)1 << 6))	data.dutyCycleNow 		= (float)dataRaw.dutyCycleNow / 1000.0f;
+	if (mask & ((uint32_t)1 << 7))	data.rpm 				= (float)dataRaw.rpm;
+	if (mask & ((uint32_t)1 << 8))	data.inpVoltage 		= (float)dataRaw.inpVoltage / 1000.0f;
+	if (mask & ((uint32_t)1 << 9))	data.ampHours 			= (float)dataRaw.ampHours / 10000.0f;
+	if (mask & ((uint32_t)1 << 10))	data.ampHoursCharged 	= (float)dataRaw.ampHoursCharged / 10000.0f;
+	if (mask & ((uint32_t)1 << 11))	data.wattHours			= (float)dataRaw.wattHours / 10000.0f;
+	if (mask & ((uint32_t)1 << 12))	data.wattHoursCharged	= (float)dataRaw.wattHoursCharged / 10000.0f;
+	if (mask & ((uint32_t)1 << 13))	data.tachometer 		= dataRaw.tachometer;
+	if (mask & ((uint32_t)1 << 14))	data.tachometerAbs 		= dataRaw.tachometerAbs;
+	if (mask & ((uint32_t)1 << 15))	data.error 				= dataRaw.error;
+	if (mask & ((uint32_t)1 << 16))	data.pidPos				= (float)dataRaw.pidPos / 1000000.0f;
+	if (mask & ((uint32_t)1 << 17))	data.id					= dataRaw.id;
+	if (mask & ((uint32_t)1 << 18)) {
+		dataExtended.tempMosfet1	= (float)dataRaw.tempMosfet1 / 10.0f;
+		dataExtended.tempMosfet2	= (float)dataRaw.tempMosfet2 / 10.0f;
+		dataExtended.tempMosfet3	= (float)dataRaw.tempMosfet3 / 10.0f;
+	}
+	if (mask & ((uint32_t)1 << 19))	dataExtended.avgVd		= (float)dataRaw.avgVd / 1000.0f;
+	if (mask & ((uint32_t)1 << 20))	dataExtended.avgVq		= (float)dataRaw.avgVq / 1000.0f;
+	if (mask & ((uint32_t)1 << 21)) {
+		dataExtended.hasTimeout			= dataRaw.status & 0x01;
+		dataExtended.killSwitchActive	= dataRaw.status & 0x02;
+	}
+
+	dataExtended.fields = mask;
+	data.rxTime_us = dataRaw.rxTime_us;
+	data.txTime_us = dataRaw.txTime_us;
+}
+
+bool VescUart::decodeImuData(uint8_t * message, int len) {
+
+	int32_t index = 0;
+
+	if (len < 2) {
+		return false;
+	}
+
+	// Every field selected by the mask is a 4 byte float32_auto
+	uint16_t mask = buffer_get_uint16(message, &index);
+	int size = 2;
+	for (uint8_t bit = 0; bit < 16; bit++) {
+		if (mask & ((uint16_t)1 << bit)) {
+			size += 4;
+		}
+	}
+	if (size > len) {
+		return false;
+	}
+
+	if (mask & ((uint16_t)1 << 0))	imu.roll	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 1))	imu.pitch	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 2))	imu.yaw		= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 3))	imu.accX	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 4))	imu.accY	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 5))	imu.accZ	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 6))	imu.gyroX	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 7))	imu.gyroY	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 8))	imu.gyroZ	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 9))	imu.magX	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 10))	imu.magY	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 11))	imu.magZ	= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 12))	imu.q0		= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 13))	imu.q1		= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 14))	imu.q2		= buffer_get_float32_auto(message, &index);
+	if (mask & ((uint16_t)1 << 15))	imu.q3		= buffer_get_float32_auto(message, &index);
+
+	imu.fields = mask;
+	return true;
+}
+
+bool VescUart::getImuData(uint16_t mask) {
+	return getImuData(mask, 0);
+}
+
+bool VescUart::getImuData(uint16_t mask, uint8_t canId) {
+
+	if (!requestImuData(mask, canId)) {
+		return false;
+	}
+
+	int messageLength = waitForPacket(COMM_GET_IMU_DATA, canId, _TIMEOUT);
+
+	if (messageLength > 0) {
+		return processReadPacket(rxBuffer, messageLength, canId);
+	}
+	return false;
+}
+
+bool VescUart::requestImuData(uint16_t mask) {
+	return requestImuData(mask, 0);
+}
+
+bool VescUart::requestImuData(uint16_t mask, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_GET_IMU_DATA "+String(canId));
+	}
+
+	int32_t index = 0;
+	uint8_t payload[3];
+
+	payload[index++] = { COMM_GET_IMU_DATA };
+	buffer_append_uint16(payload, mask, &index);
+
+	requestCanId = canId;
+	if (!setPacketHandler(COMM_GET_IMU_DATA, handleImuData, this)) {
+		return false;
+	}
+	packSendPayload(payload, index, canId);
+	return true;
+}
+
+bool VescUart::decodeBmsValues(uint8_t * message, int len) {
+
+	// Structure defined here: https://github.com/vedderb/vesc_bms_fw/blob/master/main.c
+	int32_t index = 0;
+	bmsPackage * bms = bmsTarget;
+
+	if (bms == NULL || len < 25) {
+		return false;
+	}
+
+	bms->vTot		= buffer_get_float32(message, 1000000.0, &index);
+	bms->vCharge	= buffer_get_float32(message, 1000000.0, &index);
+	bms->iIn		= buffer_get_float32(message, 1000000.0, &index);
+	bms->iInIc		= buffer_get_float32(message, 1000000.0, &index);
+	bms->ahCnt		= buffer_get_float32(message, 1000.0, &index);
+	bms->whCnt		= buffer_get_float32(message, 1000.0, &index);
+
+	// Cell voltages (2 bytes each) and balancing state (1 byte each), then the temperatures
+	uint8_t cells = message[index++];
+	if (index + cells * 3 + 1 > len) {
+		return false;
+	}
+	bms->cellNum = cells < VESCUART_BMS_MAX_CELLS ? cells : VESCUART_BMS_MAX_CELLS;
+	for (uint8_t i = 0; i < cells; i++) {
+		float v = buffer_get_float16(message, 1000.0, &index);
+		if (i < VESCUART_BMS_MAX_CELLS) {
+			bms->vCell[i] = v;
+		}
+	}
+	for (uint8_t i = 0; i < cells; i++) {
+		bool balancing = message[index++];
+		if (i < VESCUART_BMS_MAX_CELLS) {
+			bms->balanceState[i] = balancing;
+		}
+	}
+
+	uint8_t temps = message[index++];
+	if (index + temps * 2 + 13 > len) {
+		return false;
+	}
+	bms->tempNum = temps < VESCUART_BMS_MAX_TEMPS ? temps : VESCUART_BMS_MAX_TEMPS;
+	for (uint8_t i = 0; i < temps; i++) {
+		float t = buffer_get_float16(message, 100.0, &index);
+		if (i < VESCUART_BMS_MAX_TEMPS) {
+			bms->temps[i] = t;
+		}
+	}
+
+	bms->tempIc			= buffer_get_float16(message, 100.0, &index);
+	bms->tempHum		= buffer_get_float16(message, 100.0, &index);
+	bms->humidity		= buffer_get_float16(message, 100.0, &index);
+	bms->tempMaxCell	= buffer_get_float16(message, 100.0, &index);
+	bms->soc			= buffer_get_float16(message, 1000.0, &index);
+	bms->soh			= buffer_get_float16(message, 1000.0, &index);
+	bms->canId			= message[index++];
+
+	// Added in later firmware
+	if (index + 16 <= len) {
+		bms->ahCntChgTotal	= buffer_get_float32_auto(message, &index);
+		bms->whCntChgTotal	= buffer_get_float32_auto(message, &index);
+		bms->ahCntDisTotal	= buffer_get_float32_auto(message, &index);
+		bms->whCntDisTotal	= buffer_get_float32_auto(message, &index);
+	} else {
+		bms->ahCntChgTotal	= 0;
+		bms->whCntChgTotal	= 0;
+		bms->ahCntDisTotal	= 0;
+		bms->whCntDisTotal	= 0;
+	}
+
+	return true;
 }
 
-void VescUart::setSerialPort(Stream* port)
-{
-	serialPort = port;
+bool VescUart::getBmsValues(bmsPackage * bms) {
+	return getBmsValues(bms, 0);
 }
 
-void VescUart::setDebugPort(Stream* port)
-{
-	debugPort = port;
+bool VescUart::getBmsValues(bmsPackage * bms, uint8_t canId) {
+
+	if (!requestBmsValues(bms, canId)) {
+		return false;
+	}
+
+	int messageLength = waitForPacket(COMM_BMS_GET_VALUES, canId, _TIMEOUT);
+
+	if (messageLength > 0) {
+		return processReadPacket(rxBuffer, messageLength, canId);
+	}
+	return false;
 }
 
-int VescUart::receiveUartMessage(uint8_t * payloadReceived) {
+bool VescUart::requestBmsValues(bmsPackage * bms, uint8_t canId) {
 
-	// Messages <= 255 starts with "2", 2nd byte is length
-	// Messages > 255 starts with "3" 2nd and 3rd byte is length combined with 1st >>8 and then &0xFF
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_BMS_GET_VALUES "+String(canId));
+	}
 
-	// Makes no sense to run this function if no serialPort is defined.
-	if (serialPort == NULL)
-		return -1;
+	uint8_t payload[1] = { COMM_BMS_GET_VALUES };
 
-	uint16_t counter = 0;
-	uint16_t endMessage = 256;
-	bool messageRead = false;
-	uint8_t messageReceived[256];
-	uint16_t lenPayload = 0;
-	
-	uint32_t timeout = millis() + _TIMEOUT; // Defining the timestamp for timeout (100ms before timeout)
+	bmsTarget = bms;
+	requestCanId = canId;
+	if (!setPacketHandler(COMM_BMS_GET_VALUES, handleBmsValues, this)) {
+		return false;
+	}
+	packSendPayload(payload, 1, canId);
+	return true;
+}
 
-	while ( millis() < timeout && messageRead == false) {
+void VescUart::sendTerminalCmd(const char * cmd) {
+	sendTerminalCmd(cmd, 0);
+}
 
-		while (serialPort->available()) {
+void VescUart::sendTerminalCmd(const char * cmd, uint8_t canId) {
 
-			messageReceived[counter++] = serialPort->read();
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_TERMINAL_CMD "+String(canId));
+	}
 
-			if (counter == 2) {
+	sendString(COMM_TERMINAL_CMD, cmd, canId);
+}
 
-				switch (messageReceived[0])
-				{
-					case 2:
-						endMessage = messageReceived[1] + 5; //Payload size + 2 for sice + 3 for SRC and End.
-						lenPayload = messageReceived[1];
-					break;
+void VescUart::sendLispReplCmd(const char * expr) {
+	sendLispReplCmd(expr, 0);
+}
 
-					case 3:
-						// ToDo: Add Message Handling > 255 (starting with 3)
-						if( debugPort != NULL ){
-							debugPort->println("Message is larger than 256 bytes - not supported");
-						}
-					break;
+void VescUart::sendLispReplCmd(const char * expr, uint8_t canId) {
 
-					default:
-						if( debugPort != NULL ){
-							debugPort->println("Unvalid start bit");
-						}
-					break;
-				}
-			}
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_LISP_REPL_CMD "+String(canId));
+	}
 
-			if (counter >= sizeof(messageReceived)) {
-				break;
-			}
+	sendString(COMM_LISP_REPL_CMD, expr, canId);
+}
 
-			if (counter == endMessage && messageReceived[endMessage - 1] == 3) {
-				messageReceived[endMessage] = 0;
-				if (debugPort != NULL) {
-					debugPort->println("End of message reached!");
-				}
-				messageRead = true;
-				break; // Exit if end of message is reached, even if there is still more data in the buffer.
-			}
-		}
+void VescUart::sendString(COMM_PACKET_ID packetId, const char * str, uint8_t canId) {
+
+	int index = 0;
+	int len = strlen(str);
+	if (len > VESCUART_RX_BUFFER_SIZE - 1) {
+		len = VESCUART_RX_BUFFER_SIZE - 1;
 	}
-	if(messageRead == false && debugPort != NULL ) {
-		debugPort->println("Timeout");
+	uint8_t payload[1 + len];
+
+	payload[index++] = packetId;
+	memcpy(&payload[index], str, len);
+	index += len;
+
+	packSendPayload(payload, index, canId);
+}
+
+bool VescUart::setLispRunning(bool running) {
+	return setLispRunning(running, 0);
+}
+
+bool VescUart::setLispRunning(bool running, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_LISP_SET_RUNNING "+String(canId));
 	}
-	
-	bool unpacked = false;
 
-	if (messageRead) {
-		unpacked = unpackPayload(messageReceived, endMessage, payloadReceived);
+	uint8_t payload[2] = { COMM_LISP_SET_RUNNING, running };
+
+	packSendPayload(payload, 2, canId);
+
+	int messageLength = waitForPacket(COMM_LISP_SET_RUNNING, canId, _TIMEOUT);
+
+	return messageLength >= 2 && rxBuffer[1];
+}
+
+bool VescUart::getLispStats(lispStatsPackage * stats) {
+	return getLispStats(stats, 0);
+}
+
+bool VescUart::getLispStats(lispStatsPackage * stats, uint8_t canId) {
+
+	if (!requestLispStats(stats, canId)) {
+		return false;
+	}
+
+	int messageLength = waitForPacket(COMM_LISP_GET_STATS, canId, _TIMEOUT);
+
+	if (messageLength > 0) {
+		return processReadPacket(rxBuffer, messageLength, canId);
 	}
+	return false;
+}
 
-	if (unpacked) {
-		// Message was read
-		return lenPayload; 
+bool VescUart::requestLispStats(lispStatsPackage * stats, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_LISP_GET_STATS "+String(canId));
 	}
-	else {
-		// No Message Read
-		return 0;
+
+	uint8_t payload[1] = { COMM_LISP_GET_STATS };
+
+	lispStatsTarget = stats;
+	requestCanId = canId;
+	if (!setPacketHandler(COMM_LISP_GET_STATS, handleLispStats, this)) {
+		return false;
 	}
+	packSendPayload(payload, 1, canId);
+	return true;
 }
 
+bool VescUart::decodeLispStats(uint8_t * message, int len) {
 
-bool VescUart::unpackPayload(uint8_t * message, int lenMes, uint8_t * payload) {
+	// Structure defined here: https://github.com/vedderb/bldc/blob/master/lispBM/lispif.c
+	int32_t index = 0;
+	lispStatsPackage * stats = lispStatsTarget;
 
-	uint16_t crcMessage = 0;
-	uint16_t crcPayload = 0;
+	if (stats == NULL || len < 8) {
+		return false;
+	}
 
-	// Rebuild crc:
-	crcMessage = message[lenMes - 3] << 8;
-	crcMessage &= 0xFF00;
-	crcMessage += message[lenMes - 2];
+	stats->cpuUse	= buffer_get_float16(message, 100.0, &index);
+	stats->heapUse	= buffer_get_float16(message, 100.0, &index);
+	stats->memUse	= buffer_get_float16(message, 100.0, &index);
+	stats->stackUse	= buffer_get_float16(message, 100.0, &index);
 
-	if(debugPort!=NULL){
-		debugPort->print("SRC received: "); debugPort->println(crcMessage);
+	// Result of the contexts that finished, not kept
+	while (index < len && message[index] != 0) {
+		index++;
+	}
+	index++;
+
+	// Global bindings: null-terminated name followed by the value
+	stats->bindingNum = 0;
+	while (index < len) {
+		int nameStart = index;
+		while (index < len && message[index] != 0) {
+			index++;
+		}
+		index++;
+		if (index + 4 > len) {
+			break;
+		}
+
+		float value = buffer_get_float32_auto(message, &index);
+		if (stats->bindingNum < VESCUART_LISP_MAX_BINDINGS) {
+			int nameLen = index - 4 - 1 - nameStart;
+			if (nameLen > VESCUART_LISP_NAME_LEN - 1) {
+				nameLen = VESCUART_LISP_NAME_LEN - 1;
+			}
+			memcpy(stats->bindings[stats->bindingNum].name, &message[nameStart], nameLen);
+			stats->bindings[stats->bindingNum].name[nameLen] = 0;
+			stats->bindings[stats->bindingNum].value = value;
+			stats->bindingNum++;
+		}
 	}
 
-	// Extract payload:
-	memcpy(payload, &message[2], message[1]);
+	return true;
+}
 
-	crcPayload = crc16(payload, message[1]);
+bool VescUart::getStats(uint16_t mask, statsPackage * stats) {
+	return getStats(mask, stats, 0);
+}
 
-	if( debugPort != NULL ){
-		debugPort->print("SRC calc: "); debugPort->println(crcPayload);
+bool VescUart::getStats(uint16_t mask, statsPackage * stats, uint8_t canId) {
+
+	if (!requestStats(mask, stats, canId)) {
+		return false;
 	}
-	
-	if (crcPayload == crcMessage) {
-		if( debugPort != NULL ) {
-			debugPort->print("Received: "); 
-			serialPrint(message, lenMes); debugPort->println();
 
-			debugPort->print("Payload :      ");
-			serialPrint(payload, message[1] - 1); debugPort->println();
-		}
+	int messageLength = waitForPacket(COMM_GET_STATS, canId, _TIMEOUT);
 
-		return true;
-	}else{
+	if (messageLength > 0) {
+		return processReadPacket(rxBuffer, messageLength, canId);
+	}
+	return false;
+}
+
+bool VescUart::requestStats(uint16_t mask, statsPackage * stats, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_GET_STATS "+String(canId));
+	}
+
+	int32_t index = 0;
+	uint8_t payload[3];
+
+	payload[index++] = COMM_GET_STATS;
+	buffer_append_uint16(payload, mask, &index);
+
+	statsTarget = stats;
+	requestCanId = canId;
+	if (!setPacketHandler(COMM_GET_STATS, handleStats, this)) {
 		return false;
 	}
+	packSendPayload(payload, index, canId);
+	return true;
 }
 
+bool VescUart::decodeStats(uint8_t * message, int len) {
 
-int VescUart::packSendPayload(uint8_t * payload, int lenPay) {
+	// [uint32 mask][float32_auto for each bit of the mask]. Structure defined here: https://github.com/vedderb/bldc/blob/master/comm/commands.c
+	int32_t index = 0;
+	statsPackage * stats = statsTarget;
+
+	if (stats == NULL || len < 4) {
+		return false;
+	}
+
+	uint32_t mask = buffer_get_uint32(message, &index) & STATS_MASK_ALL;
 
-	uint16_t crcPayload = crc16(payload, lenPay);
 	int count = 0;
-	uint8_t messageSend[256];
-	
-	if (lenPay <= 256)
-	{
-		messageSend[count++] = 2;
-		messageSend[count++] = lenPay;
+	for (uint8_t bit = 0; bit < 11; bit++) {
+		if (mask & ((uint32_t)1 << bit)) {
+			count++;
+		}
 	}
-	else
-	{
-		messageSend[count++] = 3;
-		messageSend[count++] = (uint8_t)(lenPay >> 8);
-		messageSend[count++] = (uint8_t)(lenPay & 0xFF);
+	if (4 + 4 * count > len) {
+		if (debugPort != NULL) {
+			debugPort->println("COMM_GET_STATS reply too short for its mask");
+		}
+		return false;
 	}
 
-	memcpy(messageSend + count, payload, lenPay);
-	count += lenPay;
+	if (mask & ((uint32_t)1 << 0))	stats->speedAvg			= buffer_get_float32_auto(message, &index);	// mc_interface_stat_speed_avg()
+	if (mask & ((uint32_t)1 << 1))	stats->speedMax			= buffer_get_float32_auto(message, &index);	// mc_interface_stat_speed_max()
+	if (mask & ((uint32_t)1 << 2))	stats->powerAvg			= buffer_get_float32_auto(message, &index);	// mc_interface_stat_power_avg()
+	if (mask & ((uint32_t)1 << 3))	stats->powerMax			= buffer_get_float32_auto(message, &index);	// mc_interface_stat_power_max()
+	if (mask & ((uint32_t)1 << 4))	stats->currentAvg		= buffer_get_float32_auto(message, &index);	// mc_interface_stat_current_avg()
+	if (mask & ((uint32_t)1 << 5))	stats->currentMax		= buffer_get_float32_auto(message, &index);	// mc_interface_stat_current_max()
+	if (mask & ((uint32_t)1 << 6))	stats->tempMosfetAvg	= buffer_get_float32_auto(message, &index);	// mc_interface_stat_temp_mosfet_avg()
+	if (mask & ((uint32_t)1 << 7))	stats->tempMosfetMax	= buffer_get_float32_auto(message, &index);	// mc_interface_stat_temp_mosfet_max()
+	if (mask & ((uint32_t)1 << 8))	stats->tempMotorAvg		= buffer_get_float32_auto(message, &index);	// mc_interface_stat_temp_motor_avg()
+	if (mask & ((uint32_t)1 << 9))	stats->tempMotorMax		= buffer_get_float32_auto(message, &index);	// mc_interface_stat_temp_motor_max()
+	if (mask & ((uint32_t)1 << 10))	stats->countTime		= buffer_get_float32_auto(message, &index);	// mc_interface_stat_count_time()
+
+	stats->fields = mask;
+	return true;
+}
 
-	messageSend[count++] = (uint8_t)(crcPayload >> 8);
-	messageSend[count++] = (uint8_t)(crcPayload & 0xFF);
-	messageSend[count++] = 3;
-	// messageSend[count] = NULL;
-	
-	if(debugPort!=NULL){
-		debugPort->print("Package to send: "); serialPrint(messageSend, count);
+void VescUart::resetStats(void) {
+	resetStats(0);
+}
+
+void VescUart::resetStats(uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_RESET_STATS "+String(canId));
 	}
 
-	// Sending package
-	if( serialPort != NULL )
-		serialPort->write(messageSend, count);
+	uint8_t payload[1] = { COMM_RESET_STATS };
 
-	// Returns number of send bytes
+	packSendPayload(payload, 1, canId);
+}
+
+void VescUart::sendCustomAppData(const uint8_t * data, int len) {
+	sendCustomAppData(data, len, 0);
+}
+
+void VescUart::sendCustomAppData(const uint8_t * data, int len, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_CUSTOM_APP_DATA "+String(canId));
+	}
+
+	packSendPacket(COMM_CUSTOM_APP_DATA, data, len, canId);
+}
+
+void VescUart::setCustomAppDataHandler(customAppDataHandler handler, void * context) {
+	customAppDataCallback = handler;
+	customAppDataContext = context;
+	setPacketHandler(COMM_CUSTOM_APP_DATA, handler != NULL ? handleCustomAppData : NULL, this);
+}
+
+void VescUart::setValuesHandler(valuesHandler handler, void * context) {
+	valuesCallback = handler;
+	valuesContext = context;
+}
+
+int VescUart::printAvailable(void) {
+	return (printHead + VESCUART_PRINT_BUFFER_SIZE - printTail) % VESCUART_PRINT_BUFFER_SIZE;
+}
+
+int VescUart::readPrint(void) {
+	if (printHead == printTail) {
+		return -1;
+	}
+	char c = printBuffer[printTail];
+	printTail = (printTail + 1) % VESCUART_PRINT_BUFFER_SIZE;
+	return (uint8_t)c;
+}
+
+int VescUart::readPrint(char * buffer, int maxLen) {
+	int count = 0;
+	while (count < maxLen && printHead != printTail) {
+		buffer[count++] = printBuffer[printTail];
+		printTail = (printTail + 1) % VESCUART_PRINT_BUFFER_SIZE;
+	}
 	return count;
 }
 
+VescUart::FWcacheEntry * VescUart::findFWcacheEntry(uint8_t canId, bool create) {
 
-bool VescUart::processReadPacket(uint8_t * message) {
+	FWcacheEntry * freeEntry = NULL;
 
-	COMM_PACKET_ID packetId;
-	int32_t index = 0;
+	for (uint8_t i = 0; i < VESCUART_FW_CACHE_SIZE; i++) {
+		if (fwCache[i].used && fwCache[i].canId == canId) {
+			return &fwCache[i];
+		}
+		if (!fwCache[i].used && freeEntry == NULL) {
+			freeEntry = &fwCache[i];
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	// Only controllers that did not answer are evicted. Evicting known ones would make every poll
+	// of more controllers than the cache holds ask for the firmware again.
+	for (uint8_t i = 0; i < VESCUART_FW_CACHE_SIZE && freeEntry == NULL; i++) {
+		FWcacheEntry * entry = &fwCache[fwCacheNext];
+		fwCacheNext = (fwCacheNext + 1) % VESCUART_FW_CACHE_SIZE;
+		if (!entry->known) {
+			freeEntry = entry;
+		}
+	}
+	if (freeEntry == NULL) {
+		return NULL;
+	}
 
-	packetId = (COMM_PACKET_ID)message[0];
-	message++; // Removes the packetId from the actual message (payload)
+	memset(freeEntry, 0, sizeof(FWcacheEntry));
+	freeEntry->used = true;
+	freeEntry->canId = canId;
+	freeEntry->layout = VALUES_LAYOUT_UNKNOWN;
+	return freeEntry;
+}
 
-	switch (packetId){
-		case COMM_FW_VERSION: // Structure defined here: https://github.com/vedderb/bldc/blob/43c3bbaf91f5052a35b75c2ff17b5fe99fad94d1/commands.c#L164
+VescUart::valuesLayout VescUart::getValuesLayout(uint8_t canId) {
 
-			fw_version.major = message[index++];
-			fw_version.minor = message[index++];
-			return true;
-		case COMM_GET_VALUES: // Structure defined here: https://github.com/vedderb/bldc/blob/43c3bbaf91f5052a35b75c2ff17b5fe99fad94d1/commands.c#L164
-
-			data.tempMosfet 		= buffer_get_float16(message, 10.0, &index); 	// 2 bytes - mc_interface_temp_fet_filtered()
-			data.tempMotor 			= buffer_get_float16(message, 10.0, &index); 	// 2 bytes - mc_interface_temp_motor_filtered()
-			data.avgMotorCurrent 	= buffer_get_float32(message, 100.0, &index); // 4 bytes - mc_interface_read_reset_avg_motor_current()
-			data.avgInputCurrent 	= buffer_get_float32(message, 100.0, &index); // 4 bytes - mc_interface_read_reset_avg_input_current()
-			index += 4; // Skip 4 bytes - mc_interface_read_reset_avg_id()
-			index += 4; // Skip 4 bytes - mc_interface_read_reset_avg_iq()
-			data.dutyCycleNow 		= buffer_get_float16(message, 1000.0, &index); 	// 2 bytes - mc_interface_get_duty_cycle_now()
-			data.rpm 				= buffer_get_float32(message, 1.0, &index);		// 4 bytes - mc_interface_get_rpm()
-			data.inpVoltage 		= buffer_get_float16(message, 10.0, &index);		// 2 bytes - GET_INPUT_VOLTAGE()
-			data.ampHours 			= buffer_get_float32(message, 10000.0, &index);	// 4 bytes - mc_interface_get_amp_hours(false)
-			data.ampHoursCharged 	= buffer_get_float32(message, 10000.0, &index);	// 4 bytes - mc_interface_get_amp_hours_charged(false)
-			data.wattHours			= buffer_get_float32(message, 10000.0, &index);	// 4 bytes - mc_interface_get_watt_hours(false)
-			data.wattHoursCharged	= buffer_get_float32(message, 10000.0, &index);	// 4 bytes - mc_interface_get_watt_hours_charged(false)
-			data.tachometer 		= buffer_get_int32(message, &index);				// 4 bytes - mc_interface_get_tachometer_value(false)
-			data.tachometerAbs 		= buffer_get_int32(message, &index);				// 4 bytes - mc_interface_get_tachometer_abs_value(false)
-			data.error 				= (mc_fault_code)message[index++];								// 1 byte  - mc_interface_get_fault()
-			data.pidPos				= buffer_get_float32(message, 1000000.0, &index);	// 4 bytes - mc_interface_get_pid_pos_now()
-			data.id					= message[index++];								// 1 byte  - app_get_configuration()->controller_id	
+	FWcacheEntry * entry = findFWcacheEntry(canId, false);
 
-			return true;
+	if (entry == NULL) {
+		return VALUES_LAYOUT_UNKNOWN;
+	}
+	return entry->layout;
+}
+
+uint32_t VescUart::getValuesFields(uint8_t canId) {
+	return valuesLayoutMax[getValuesLayout(canId)];
+}
+
+void VescUart::queryFWversionOnce(uint8_t canId) {
+
+	if (findFWcacheEntry(canId, false) != NULL) {
+		return;
+	}
 
-		break;
+	// Ask once; if the controller does not answer, the entry remembers that so that the
+	// handshake is not repeated on every request. Without room for the entry, do not ask at all.
+	if (findFWcacheEntry(canId, true) != NULL) {
+		getFWversion(canId);
+	}
+}
 
-		/* case COMM_GET_VALUES_SELECTIVE:
+const VescUart::FWversionPackage * VescUart::getCachedFWversion(uint8_t canId) {
 
-			uint32_t mask = 0xFFFFFFFF; */
+	FWcacheEntry * entry = findFWcacheEntry(canId, false);
 
-		default:
-			return false;
-		break;
+	if (entry == NULL || !entry->known) {
+		return NULL;
 	}
+	return &entry->fw;
+}
+
+void VescUart::clearFWcache(void) {
+	memset(fwCache, 0, sizeof(fwCache));
+	fwCacheNext = 0;
 }
 
 bool VescUart::getFWversion(void){
@@ -243,12 +1287,14 @@ bool VescUart::getFWversion(uint8_t canId){
 	}
 	payload[index++] = { COMM_FW_VERSION };
 
+	if (!setPacketHandler(COMM_FW_VERSION, handleFWversion, this)) {
+		return false;
+	}
 	packSendPayload(payload, payloadSize);
 
-	uint8_t message[256];
-	int messageLength = receiveUartMessage(message);
+	int messageLength = waitForPacket(COMM_FW_VERSION, canId, _TIMEOUT);
 	if (messageLength > 0) { 
-		return processReadPacket(message); 
+		return processReadPacket(rxBuffer, messageLength, canId); 
 	}
 	return false;
 }
@@ -259,6 +1305,19 @@ bool VescUart::getVescValues(void) {
 
 bool VescUart::getVescValues(uint8_t canId) {
 
+	if (getVescValuesRaw(canId)) {
+		convertRawValues();
+		return true;
+	}
+	return false;
+}
+
+bool VescUart::getVescValuesRaw(void) {
+	return getVescValuesRaw(0);
+}
+
+bool VescUart::getVescValuesRaw(uint8_t canId) {
+
 	if (debugPort!=NULL){
 		debugPort->println("Command: COMM_GET_VALUES "+String(canId));
 	}
@@ -272,16 +1331,78 @@ bool VescUart::getVescValues(uint8_t canId) {
 	}
 	payload[index++] = { COMM_GET_VALUES };
 
+	queryFWversionOnce(canId);
+
+	if (!setPacketHandler(COMM_GET_VALUES, handleValues, this)) {
+		return false;
+	}
+	addPending(canId);
 	packSendPayload(payload, payloadSize);
 
-	uint8_t message[256];
-	int messageLength = receiveUartMessage(message);
+	int messageLength = waitForPacket(COMM_GET_VALUES, canId, _TIMEOUT);
 
-	if (messageLength > 55) {
-		return processReadPacket(message); 
+	if (messageLength > 0) {
+		return processReadPacket(rxBuffer, messageLength, canId); 
 	}
 	return false;
 }
+
+bool VescUart::requestVescValues(void) {
+	return requestVescValues(0);
+}
+
+bool VescUart::requestVescValues(uint8_t canId) {
+
+	// The reply layout depends on the firmware. Ask for it without waiting; the reply
+	// arrives, and is decoded, before the values.
+	if (findFWcacheEntry(canId, false) == NULL && findFWcacheEntry(canId, true) != NULL) {
+		uint8_t payload[1] = { COMM_FW_VERSION };
+		if (!setPacketHandler(COMM_FW_VERSION, handleFWversion, this)) {
+			return false;
+		}
+		packSendPayload(payload, 1, canId);
+	}
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_GET_VALUES "+String(canId));
+	}
+
+	uint8_t payload[1] = { COMM_GET_VALUES };
+
+	requestCanId = canId;
+	if (!setPacketHandler(COMM_GET_VALUES, handleValues, this)) {
+		return false;
+	}
+	addPending(canId);
+	packSendPayload(payload, 1, canId);
+	return true;
+}
+
+bool VescUart::requestVescValuesSelective(uint32_t mask) {
+	return requestVescValuesSelective(mask, 0);
+}
+
+bool VescUart::requestVescValuesSelective(uint32_t mask, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_GET_VALUES_SELECTIVE "+String(canId));
+	}
+
+	int32_t index = 0;
+	uint8_t payload[5];
+
+	payload[index++] = COMM_GET_VALUES_SELECTIVE;
+	buffer_append_uint32(payload, mask, &index);
+
+	requestCanId = canId;
+	if (!setPacketHandler(COMM_GET_VALUES_SELECTIVE, handleValuesSelective, this)) {
+		return false;
+	}
+	addPending(canId);
+	packSendPayload(payload, index, canId);
+	return true;
+}
+
 void VescUart::setNunchuckValues() {
 	return setNunchuckValues(0);
 }
@@ -409,6 +1530,53 @@ void VescUart::sendKeepalive(uint8_t canId) {
 	packSendPayload(payload, payloadSize);
 }
 
+bool VescUart::setMcconfTemp(const mcconfTempPackage & limits, bool store, bool ack) {
+	return setMcconfTemp(limits, store, ack, 0);
+}
+
+bool VescUart::setMcconfTemp(const mcconfTempPackage & limits, bool store, bool ack, uint8_t canId) {
+	return sendMcconfTemp(COMM_SET_MCCONF_TEMP, limits, store, false, ack, false, canId);
+}
+
+bool VescUart::setMcconfTempSetup(const mcconfTempPackage & limits, bool store, bool ack, bool divideByControllers) {
+	return sendMcconfTemp(COMM_SET_MCCONF_TEMP_SETUP, limits, store, true, ack, divideByControllers, 0);
+}
+
+bool VescUart::sendMcconfTemp(COMM_PACKET_ID packetId, const mcconfTempPackage & limits, bool store, bool forward, bool ack, bool divide, uint8_t canId) {
+
+	if (debugPort!=NULL){
+		debugPort->println("Command: COMM_SET_MCCONF_TEMP "+String(canId));
+	}
+
+	// Structure defined here: https://github.com/vedderb/bldc/blob/master/comm/commands.c
+	int32_t index = 0;
+	uint8_t payload[45];
+
+	payload[index++] = packetId;
+	payload[index++] = store;
+	payload[index++] = forward;
+	payload[index++] = ack;
+	payload[index++] = divide;
+	buffer_append_float32_auto(payload, limits.currentMinScale, &index);
+	buffer_append_float32_auto(payload, limits.currentMaxScale, &index);
+	buffer_append_float32_auto(payload, limits.erpmMin, &index);
+	buffer_append_float32_auto(payload, limits.erpmMax, &index);
+	buffer_append_float32_auto(payload, limits.dutyMin, &index);
+	buffer_append_float32_auto(payload, limits.dutyMax, &index);
+	buffer_append_float32_auto(payload, limits.wattMin, &index);
+	buffer_append_float32_auto(payload, limits.wattMax, &index);
+	buffer_append_float32_auto(payload, limits.inCurrentMin, &index);	// Optional in the firmware, sent for
+	buffer_append_float32_auto(payload, limits.inCurrentMax, &index);	// the battery current limits
+
+	packSendPayload(payload, index, canId);
+
+	if (!ack) {
+		return true;
+	}
+
+	return waitForPacket(packetId, canId, store ? 2000 : _TIMEOUT) > 0;
+}
+
 void VescUart::serialPrint(uint8_t * data, int len) {
 	if(debugPort != NULL){
 		for (int i = 0; i <= len; i++)
@@ -438,3 +1606,17 @@ void VescUart::printVescValues() {
 		debugPort->print("error: "); 			debugPort->println(data.error);
 	}
 }
+
+void VescUart::printVescValuesExtended() {
+	if(debugPort != NULL){
+		debugPort->print("avgId: "); 			debugPort->println(dataExtended.avgId);
+		debugPort->print("avgIq: "); 			debugPort->println(dataExtended.avgIq);
+		debugPort->print("avgVd: "); 			debugPort->println(dataExtended.avgVd);
+		debugPort->print("avgVq: "); 			debugPort->println(dataExtended.avgVq);
+		debugPort->print("tempMosfet1: "); 		debugPort->println(dataExtended.tempMosfet1);
+		debugPort->print("tempMosfet2: "); 		debugPort->println(dataExtended.tempMosfet2);
+		debugPort->print("tempMosfet3: "); 		debugPort->println(dataExtended.tempMosfet3);
+		debugPort->print("hasTimeout: "); 		debugPort->println(dataExtended.hasTimeout);
+		debugPort->print("killSwitchActive: "); debugPort->println(dataExtended.killSwitchActive);
+	}
+}
@@ -6,8 +6,137 @@
 #include "buffer.h"
 #include "crc.h"
 
+/** Number of controllers whose firmware version is remembered (one entry per CAN ID). Entries of
+    controllers that answered are kept; once all are taken, further controllers are not asked and
+    their values replies are decoded by their length. Poll at most this many controllers to get
+    the layout of each from its firmware version. */
+#ifndef VESCUART_FW_CACHE_SIZE
+#if !defined(ARDUINO) && defined(__linux__)
+#define VESCUART_FW_CACHE_SIZE 32
+#else
+#define VESCUART_FW_CACHE_SIZE 4
+#endif
+#endif
+
+/** Maximum length of the hardware name returned by COMM_FW_VERSION (including terminator) */
+#ifndef VESCUART_HW_NAME_LEN
+#define VESCUART_HW_NAME_LEN 24
+#endif
+
+/** Size of the receive buffer, i.e. the longest payload that can be received */
+#ifndef VESCUART_RX_BUFFER_SIZE
+#if defined(__AVR__)
+#define VESCUART_RX_BUFFER_SIZE 256
+#else
+#define VESCUART_RX_BUFFER_SIZE 1024
+#endif
+#endif
+
+/** Number of packet ids, i.e. the size of the handler dispatch table */
+#define VESCUART_PACKET_ID_COUNT (COMM_LISP_REPL_CMD + 1)
+
+/** Number of packet handlers that can be registered at once, including the built-in decoders in use.
+  * Packet ids with the same handler and context share one. The built-in decoders take up to 9,
+  * VescSampler takes 1 more. */
+#ifndef VESCUART_MAX_HANDLERS
+#if defined(__AVR__)
+#define VESCUART_MAX_HANDLERS 12
+#else
+#define VESCUART_MAX_HANDLERS 24
+#endif
+#endif
+
+/** Size of the ring buffer holding text received in COMM_PRINT and COMM_LISP_PRINT messages */
+#ifndef VESCUART_PRINT_BUFFER_SIZE
+#if defined(__AVR__)
+#define VESCUART_PRINT_BUFFER_SIZE 64
+#else
+#define VESCUART_PRINT_BUFFER_SIZE 256
+#endif
+#endif
+
+/** Capacity of bmsPackage; cells and temperatures beyond this are skipped */
+#ifndef VESCUART_BMS_MAX_CELLS
+#define VESCUART_BMS_MAX_CELLS 32
+#endif
+#ifndef VESCUART_BMS_MAX_TEMPS
+#define VESCUART_BMS_MAX_TEMPS 16
+#endif
+
+/** Capacity of lispStatsPackage; further global bindings are skipped */
+#ifndef VESCUART_LISP_MAX_BINDINGS
+#define VESCUART_LISP_MAX_BINDINGS 8
+#endif
+#ifndef VESCUART_LISP_NAME_LEN
+#define VESCUART_LISP_NAME_LEN 16
+#endif
+
+/** Number of values requests whose send time is kept until their reply arrives */
+#ifndef VESCUART_MAX_PENDING
+#if defined(__AVR__)
+#define VESCUART_MAX_PENDING 4
+#else
+#define VESCUART_MAX_PENDING 16
+#endif
+#endif
+
+/** Field masks for getImuData() and requestImuData() */
+#define IMU_MASK_RPY		0x0007	// Roll, pitch, yaw
+#define IMU_MASK_ACC		0x0038	// Accelerometer x, y, z
+#define IMU_MASK_GYRO		0x01C0	// Gyroscope x, y, z
+#define IMU_MASK_MAG		0x0E00	// Magnetometer x, y, z
+#define IMU_MASK_QUAT		0xF000	// Quaternion q0 .. q3
+#define IMU_MASK_ALL		0xFFFF
+
+/** Field masks for getStats() and requestStats() */
+#define STATS_MASK_SPEED		0x0003	// Average and maximum
+#define STATS_MASK_POWER		0x000C
+#define STATS_MASK_CURRENT		0x0030
+#define STATS_MASK_TEMP_MOSFET	0x00C0
+#define STATS_MASK_TEMP_MOTOR	0x0300
+#define STATS_MASK_TIME			0x0400
+#define STATS_MASK_ALL			0x07FF
+
+/** Field masks for requestVescValuesSelective(), one bit per COMM_GET_VALUES field */
+#define VALUES_MASK_TEMP_MOSFET		0x00000001
+#define VALUES_MASK_TEMP_MOTOR		0x00000002
+#define VALUES_MASK_MOTOR_CURRENT	0x00000004
+#define VALUES_MASK_INPUT_CURRENT	0x00000008
+#define VALUES_MASK_ID				0x00000010
+#define VALUES_MASK_IQ				0x00000020
+#define VALUES_MASK_DUTY			0x00000040
+#define VALUES_MASK_RPM				0x00000080
+#define VALUES_MASK_INPUT_VOLTAGE	0x00000100
+#define VALUES_MASK_AMP_HOURS		0x00000600	// Drawn and charged
+#define VALUES_MASK_WATT_HOURS		0x00001800	// Drawn and charged
+#define VALUES_MASK_TACHOMETER		0x00006000	// Signed and absolute
+#define VALUES_MASK_FAULT			0x00008000
+#define VALUES_MASK_PID_POS			0x00010000
+#define VALUES_MASK_CONTROLLER_ID	0x00020000
+#define VALUES_MASK_TEMP_MOSFETS	0x00040000	// Per phase
+#define VALUES_MASK_VD_VQ			0x00180000
+#define VALUES_MASK_STATUS			0x00200000
+#define VALUES_MASK_ALL				0x003FFFFF
+
 class VescUart
 {
+	friend class VescConfig;
+	friend class VescSampler;
+	friend class VescUploader;
+	friend class VescAsync;
+	friend class VescPlanner;
+	friend class VescTelemetryEncoder;
+	friend class VescTelemetryDecoder;
+	friend class VescMetrics;
+	friend class VescHistory;
+	friend class VescFaultCapture;
+
+	/** Registered packet handler */
+	struct handlerEntry {
+		bool (*handler)(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		void * context;
+		uint8_t users;	// Packet ids dispatched to this entry, 0 if it is free
+	};
 
 	/** Struct to store the telemetry data returned by the VESC */
 	struct dataPackage {
@@ -27,6 +156,74 @@ class VescUart
         float pidPos;
         uint8_t id;
         mc_fault_code error; 
+        uint32_t rxTime_us;
+        uint32_t txTime_us;
+	};
+
+	/** Struct to store the extended telemetry returned by newer firmware (FOC and per-phase data) */
+	struct extendedDataPackage {
+		float avgId;
+		float avgIq;
+		float avgVd;
+		float avgVq;
+		float tempMosfet1;
+		float tempMosfet2;
+		float tempMosfet3;
+		bool hasTimeout;
+		bool killSwitchActive;
+		uint32_t fields; // COMM_GET_VALUES_SELECTIVE mask of the fields present in the last reply
+	};
+
+	/** Struct to store the telemetry as scaled integers, so that no float math is needed on 8-bit MCUs */
+	struct rawDataPackage {
+		int32_t avgMotorCurrent;	// mA
+		int32_t avgInputCurrent;	// mA
+		int32_t avgId;				// mA
+		int32_t avgIq;				// mA
+		int32_t avgVd;				// mV
+		int32_t avgVq;				// mV
+		int16_t dutyCycleNow;		// 0.1 %
+		int32_t rpm;				// ERPM
+		int32_t inpVoltage;			// mV
+		int32_t ampHours;			// 0.1 mAh
+		int32_t ampHoursCharged;	// 0.1 mAh
+		int32_t wattHours;			// 0.1 mWh
+		int32_t wattHoursCharged;	// 0.1 mWh
+		int32_t tachometer;
+		int32_t tachometerAbs;
+		int16_t tempMosfet;			// 0.1 degC
+		int16_t tempMotor;			// 0.1 degC
+		int16_t tempMosfet1;		// 0.1 degC
+		int16_t tempMosfet2;		// 0.1 degC
+		int16_t tempMosfet3;		// 0.1 degC
+		int32_t pidPos;				// 1e-6 deg
+		uint8_t id;
+		uint8_t status;				// Bit 0: timeout, bit 1: kill switch active
+		mc_fault_code error;
+		uint32_t fields;			// COMM_GET_VALUES_SELECTIVE mask of the fields present in the last reply
+		uint32_t rxTime_us;			// micros() when the start byte of the reply was read
+		uint32_t txTime_us;			// micros() when the request was sent, 0 if it is not known
+	};
+
+	/** Struct to store the IMU data returned by COMM_GET_IMU_DATA */
+	struct imuPackage {
+		float roll;		// rad
+		float pitch;
+		float yaw;
+		float accX;		// g
+		float accY;
+		float accZ;
+		float gyroX;	// deg/s
+		float gyroY;
+		float gyroZ;
+		float magX;
+		float magY;
+		float magZ;
+		float q0;		// Attitude quaternion, as in ATTITUDE_INFO
+		float q1;
+		float q2;
+		float q3;
+		uint16_t fields; // Mask of the fields present in the last reply
 	};
 
 	/** Struct to hold the nunchuck values to send over UART */
@@ -37,15 +234,120 @@ class VescUart
 		bool lowerButton; // valLowerButton
 	};
 
+    /** Struct to store the firmware information returned by COMM_FW_VERSION */
     struct FWversionPackage {
         uint8_t major;
         uint8_t minor;
+        char hwName[VESCUART_HW_NAME_LEN];
+        uint8_t uuid[12];
+        bool pairingDone;
+        uint8_t testVersion;
+        HW_TYPE hwType;
     };
 
+	/** Layouts of the COMM_GET_VALUES reply, selected from the firmware version */
+	enum valuesLayout {
+		VALUES_LAYOUT_UNKNOWN = 0,	// Firmware version not known, decode what is present
+		VALUES_LAYOUT_FW2,			// Up to the fault code
+		VALUES_LAYOUT_FW3,			// Adds pid position and controller id
+		VALUES_LAYOUT_FW5			// Adds per-phase MOSFET temps, vd/vq and status
+	};
+
+	/** Cached firmware information of a single controller */
+	struct FWcacheEntry {
+		bool used;
+		bool known;		// False if the controller did not answer COMM_FW_VERSION
+		uint8_t canId;
+		valuesLayout layout;
+		FWversionPackage fw;
+	};
+
 	//Timeout - specifies how long the function will wait for the vesc to respond
 	const uint32_t _TIMEOUT;
 
 	public:
+		/** Struct to hold the temporary (not stored) motor limits sent with COMM_SET_MCCONF_TEMP */
+		struct mcconfTempPackage {
+			float currentMinScale;	// Scale of the motor current limits (0.0 - 1.0)
+			float currentMaxScale;
+			float erpmMin;			// ERPM, or speed in m/s with setMcconfTempSetup()
+			float erpmMax;
+			float dutyMin;
+			float dutyMax;
+			float wattMin;			// Watt limits, for the whole setup if divideByControllers is set
+			float wattMax;
+			float inCurrentMin;		// Battery current limits
+			float inCurrentMax;
+		};
+
+		/** Struct to store the values returned by a VESC BMS (COMM_BMS_GET_VALUES) */
+		struct bmsPackage {
+			float vTot;				// V
+			float vCharge;			// V
+			float iIn;				// A
+			float iInIc;			// A
+			float ahCnt;
+			float whCnt;
+			uint8_t cellNum;		// Number of cells in vCell and balanceState
+			float vCell[VESCUART_BMS_MAX_CELLS];
+			bool balanceState[VESCUART_BMS_MAX_CELLS];
+			uint8_t tempNum;		// Number of temperatures in temps
+			float temps[VESCUART_BMS_MAX_TEMPS];
+			float tempIc;			// degC
+			float tempHum;
+			float humidity;			// %
+			float tempMaxCell;
+			float soc;				// 0.0 - 1.0
+			float soh;				// 0.0 - 1.0
+			uint8_t canId;
+			float ahCntChgTotal;	// Lifetime counters, 0 on firmware that does not send them
+			float whCntChgTotal;
+			float ahCntDisTotal;
+			float whCntDisTotal;
+		};
+
+		/** Struct to store the LispBM runtime statistics (COMM_LISP_GET_STATS) */
+		struct lispStatsPackage {
+			float cpuUse;			// %
+			float heapUse;			// %
+			float memUse;			// %
+			float stackUse;			// %
+			uint8_t bindingNum;		// Number of entries in bindings
+			struct {
+				char name[VESCUART_LISP_NAME_LEN];
+				float value;
+			} bindings[VESCUART_LISP_MAX_BINDINGS];
+		};
+
+		/** Struct to store the statistics the VESC keeps since its last reset (COMM_GET_STATS) */
+		struct statsPackage {
+			float speedAvg;			// m/s, from the wheel settings of the motor configuration
+			float speedMax;
+			float powerAvg;			// W
+			float powerMax;
+			float currentAvg;		// A
+			float currentMax;
+			float tempMosfetAvg;	// degC
+			float tempMosfetMax;
+			float tempMotorAvg;		// degC
+			float tempMotorMax;
+			float countTime;		// s the statistics cover
+			uint32_t fields;		// STATS_MASK_* bits of the fields present in the last reply
+		};
+
+		/**
+		 * Decodes a received packet. data points into the receive buffer, after the packet id,
+		 * and is only valid during the call. canId is the CAN ID the last request was sent to.
+		 * Returns true if the packet was handled.
+		 */
+		typedef bool (*packetHandler)(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+
+		/** Receives the data of a COMM_CUSTOM_APP_DATA message, without the packet id */
+		typedef void (*customAppDataHandler)(const uint8_t * data, int len, void * context);
+
+		/** Called once per decoded values reply, while dataRaw holds it; canId is the controller that sent it */
+		typedef void (*valuesHandler)(uint8_t canId, void * context);
+
 		/**
 		 * @brief      Class constructor
 		 */
@@ -54,6 +356,15 @@ class VescUart
 		/** Variabel to hold measurements returned from VESC */
 		dataPackage data; 
 
+		/** Variabel to hold measurements as scaled integers, filled by getVescValuesRaw() and getVescValues() */
+		rawDataPackage dataRaw;
+
+		/** Variabel to hold the extended measurements (id/iq, vd/vq, MOSFET temps, status) */
+		extendedDataPackage dataExtended;
+
+		/** Variabel to hold the IMU data, filled by getImuData() or update() */
+		imuPackage imu;
+
 		/** Variabel to hold nunchuck values */
 		nunchuckPackage nunchuck; 
 
@@ -72,6 +383,13 @@ class VescUart
          */
         void setDebugPort(Stream* port);
 
+        /**
+         * @brief      Set the baud rate of the serial port, 8N1. With it the receive time of a
+         *             reply is corrected for the bytes that already waited in the serial buffer.
+         * @param      baud  - The baud rate, 0 if not known
+         */
+        void setBaudRate(uint32_t baud);
+
         /**
          * @brief      Populate the firmware version variables
          *
@@ -87,6 +405,20 @@ class VescUart
          */
         bool getFWversion(uint8_t canId);
 
+        /**
+         * @brief      Get the cached firmware version of a controller
+         *
+         * @param      canId  - The CAN ID of the VESC (0 for the local VESC)
+         * @return     Pointer to the cached version, or NULL if not known
+         */
+        const FWversionPackage * getCachedFWversion(uint8_t canId);
+
+        /**
+         * @brief      Forget all cached firmware versions, e.g. after a firmware update.
+         *             The version is queried again on the next getVescValues().
+         */
+        void clearFWcache(void);
+
         /**
          * @brief      Sends a command to VESC and stores the returned data
          *
@@ -95,13 +427,333 @@ class VescUart
         bool getVescValues(void);
 
         /**
-         * @brief      Sends a command to VESC and stores the returned data
+         * @brief      Sends a command to VESC and stores the returned data in data and dataExtended.
+         *             The reply is decoded with the layout matching the cached firmware
+         *             version of the controller, which is queried once on first use.
          * @param      canId  - The CAN ID of the VESC
          *
          * @return     True if successfull otherwise false
          */
         bool getVescValues(uint8_t canId);
 
+        /**
+         * @brief      Sends a command to VESC and stores the returned data in dataRaw only,
+         *             using integer math. Use this on MCUs without an FPU.
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getVescValuesRaw(void);
+
+        /**
+         * @brief      Sends a command to VESC and stores the returned data in dataRaw only,
+         *             using integer math. Use this on MCUs without an FPU.
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getVescValuesRaw(uint8_t canId);
+
+        /**
+         * @brief      Converts the integer values in dataRaw to floats in data and dataExtended
+         */
+        void convertRawValues(void);
+
+        /**
+         * @brief      Requests the telemetry values without waiting. The reply is decoded into
+         *             dataRaw by update(); call convertRawValues() for the float values.
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestVescValues(void);
+
+        /**
+         * @brief      Requests the telemetry values without waiting. If the firmware version of
+         *             the controller is not known yet, it is requested as well.
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestVescValues(uint8_t canId);
+
+        /**
+         * @brief      Requests only the telemetry fields in mask, without waiting. The reply is
+         *             decoded into dataRaw by update(); dataRaw.fields tells which fields it held.
+         * @param      mask  - The fields to request, see VALUES_MASK_*
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestVescValuesSelective(uint32_t mask);
+
+        /**
+         * @brief      Requests only the telemetry fields in mask, without waiting.
+         * @param      mask   - The fields to request, see VALUES_MASK_*
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestVescValuesSelective(uint32_t mask, uint8_t canId);
+
+        /**
+         * @brief      Size of the telemetry fields in mask as they are sent by the VESC
+         * @param      mask  - The fields, see VALUES_MASK_*
+         * @return     Number of payload bytes
+         */
+        static int valuesSize(uint32_t mask);
+
+        /**
+         * @brief      Requests the IMU data and waits for the reply
+         * @param      mask  - The fields to request, see IMU_MASK_*
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getImuData(uint16_t mask);
+
+        /**
+         * @brief      Requests the IMU data and waits for the reply
+         * @param      mask   - The fields to request, see IMU_MASK_*
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getImuData(uint16_t mask, uint8_t canId);
+
+        /**
+         * @brief      Requests the IMU data without waiting. The reply is decoded by update().
+         * @param      mask  - The fields to request, see IMU_MASK_*
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestImuData(uint16_t mask);
+
+        /**
+         * @brief      Requests the IMU data without waiting. The reply is decoded by update().
+         * @param      mask   - The fields to request, see IMU_MASK_*
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestImuData(uint16_t mask, uint8_t canId);
+
+        /**
+         * @brief      Requests the values of a VESC BMS and waits for the reply
+         * @param      bms  - The struct to fill
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getBmsValues(bmsPackage * bms);
+
+        /**
+         * @brief      Requests the values of a VESC BMS and waits for the reply
+         * @param      bms    - The struct to fill
+         * @param      canId  - The CAN ID of the BMS
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getBmsValues(bmsPackage * bms, uint8_t canId);
+
+        /**
+         * @brief      Requests the values of a VESC BMS without waiting. The reply is decoded
+         *             into bms by update(), so bms must stay valid until then.
+         * @param      bms    - The struct to fill
+         * @param      canId  - The CAN ID of the BMS
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestBmsValues(bmsPackage * bms, uint8_t canId);
+
+        /**
+         * @brief      Sends a terminal command without waiting for the output. The output
+         *             arrives as COMM_PRINT messages and is collected by update().
+         * @param      cmd  - The command, e.g. "faults"
+         */
+        void sendTerminalCmd(const char * cmd);
+
+        /**
+         * @brief      Sends a terminal command without waiting for the output
+         * @param      cmd    - The command, e.g. "faults"
+         * @param      canId  - The CAN ID of the VESC
+         */
+        void sendTerminalCmd(const char * cmd, uint8_t canId);
+
+        /**
+         * @brief      Sends an expression to the LispBM REPL without waiting for the result. The
+         *             result arrives as COMM_LISP_PRINT messages, read it with readPrint().
+         * @param      expr  - The expression, e.g. "(+ 1 2)"
+         */
+        void sendLispReplCmd(const char * expr);
+
+        /**
+         * @brief      Sends an expression to the LispBM REPL without waiting for the result
+         * @param      expr   - The expression, e.g. "(+ 1 2)"
+         * @param      canId  - The CAN ID of the VESC
+         */
+        void sendLispReplCmd(const char * expr, uint8_t canId);
+
+        /**
+         * @brief      Starts or stops the LispBM script
+         * @param      running  - True to start
+         *
+         * @return     True if the VESC acknowledged it
+         */
+        bool setLispRunning(bool running);
+
+        /**
+         * @brief      Starts or stops the LispBM script
+         * @param      running  - True to start
+         * @param      canId    - The CAN ID of the VESC
+         *
+         * @return     True if the VESC acknowledged it
+         */
+        bool setLispRunning(bool running, uint8_t canId);
+
+        /**
+         * @brief      Requests the LispBM runtime statistics and waits for the reply
+         * @param      stats  - The struct to fill
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getLispStats(lispStatsPackage * stats);
+
+        /**
+         * @brief      Requests the LispBM runtime statistics and waits for the reply
+         * @param      stats  - The struct to fill
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getLispStats(lispStatsPackage * stats, uint8_t canId);
+
+        /**
+         * @brief      Requests the LispBM runtime statistics without waiting. The reply is
+         *             decoded into stats by update(), so stats must stay valid until then.
+         * @param      stats  - The struct to fill
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestLispStats(lispStatsPackage * stats, uint8_t canId);
+
+        /**
+         * @brief      Requests the statistics the VESC keeps since its last reset and waits for the reply.
+         *             One request covers the whole session, instead of polling values at full rate.
+         * @param      mask   - The fields, see STATS_MASK_*
+         * @param      stats  - The struct to fill; fields not in the mask are left as they are
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getStats(uint16_t mask, statsPackage * stats);
+
+        /**
+         * @brief      Requests the statistics the VESC keeps since its last reset and waits for the reply
+         * @param      mask   - The fields, see STATS_MASK_*
+         * @param      stats  - The struct to fill; fields not in the mask are left as they are
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     True if successfull otherwise false
+         */
+        bool getStats(uint16_t mask, statsPackage * stats, uint8_t canId);
+
+        /**
+         * @brief      Requests the statistics without waiting. The reply is decoded into stats
+         *             by update(), so stats must stay valid until then.
+         * @param      mask   - The fields, see STATS_MASK_*
+         * @param      stats  - The struct to fill
+         * @param      canId  - The CAN ID of the VESC
+         *
+         * @return     False if no packet handler was free for the reply; nothing is sent then
+         */
+        bool requestStats(uint16_t mask, statsPackage * stats, uint8_t canId);
+
+        /**
+         * @brief      Starts a new statistics session on the VESC
+         */
+        void resetStats(void);
+
+        /**
+         * @brief      Starts a new statistics session on the VESC
+         * @param      canId  - The CAN ID of the VESC
+         */
+        void resetStats(uint8_t canId);
+
+        /**
+         * @brief      Sends data to the custom app of the VESC (COMM_CUSTOM_APP_DATA)
+         * @param      data  - The data
+         * @param      len   - Length of data
+         */
+        void sendCustomAppData(const uint8_t * data, int len);
+
+        /**
+         * @brief      Sends data to the custom app of the VESC (COMM_CUSTOM_APP_DATA)
+         * @param      data   - The data
+         * @param      len    - Length of data
+         * @param      canId  - The CAN ID of the VESC
+         */
+        void sendCustomAppData(const uint8_t * data, int len, uint8_t canId);
+
+        /**
+         * @brief      Sets the function called by update() with the data of every COMM_CUSTOM_APP_DATA
+         *             message. The data points into the receive buffer and is only valid during the call.
+         * @param      handler  - The function, or NULL
+         * @param      context  - Passed to the function as is
+         */
+        void setCustomAppDataHandler(customAppDataHandler handler, void * context);
+
+        /**
+         * @brief      Sets the function called for every values reply (COMM_GET_VALUES and
+         *             COMM_GET_VALUES_SELECTIVE), right after it is decoded into dataRaw. update()
+         *             decodes all messages that arrived into the same dataRaw, so this is the way to
+         *             see each sample when several replies arrive between two calls.
+         * @param      handler  - The function, or NULL
+         * @param      context  - Passed to the function as is
+         */
+        void setValuesHandler(valuesHandler handler, void * context);
+
+        /**
+         * @brief      Sets the function that decodes a packet id, replacing the previous one. The
+         *             built-in decoders are set by the functions that request them, e.g.
+         *             requestImuData(), so only the decoders an application uses are linked.
+         *             Packet ids with the same handler and context share one entry.
+         * @param      packetId  - The packet id
+         * @param      handler   - The function, or NULL to ignore the packet id
+         * @param      context   - Passed to the function as is
+         *
+         * @return     False if the packet id is unknown or VESCUART_MAX_HANDLERS are in use
+         */
+        bool setPacketHandler(uint8_t packetId, packetHandler handler, void * context);
+
+        /**
+         * @brief      Number of received terminal characters waiting to be read
+         */
+        int printAvailable(void);
+
+        /**
+         * @brief      Reads one received terminal character
+         *
+         * @return     The character, or -1 if the buffer is empty
+         */
+        int readPrint(void);
+
+        /**
+         * @brief      Reads received terminal text into a buffer
+         * @param      buffer  - Where to copy the text, not null-terminated
+         * @param      maxLen  - Size of buffer
+         *
+         * @return     The number of characters copied
+         */
+        int readPrint(char * buffer, int maxLen);
+
+        /** Number of terminal and LispBM characters dropped because the print buffer was full */
+        uint32_t printDropped = 0;
+
+        /**
+         * @brief      Reads the bytes available on the serial port without blocking and
+         *             decodes every complete message. Call this often from loop().
+         *
+         * @return     The number of messages decoded, of any type. Only the last values reply
+         *             is left in dataRaw; use setValuesHandler() to see every one.
+         */
+        int update(void);
+
         /**
          * @brief      Sends values for joystick and buttons to the nunchuck app
          */
@@ -176,11 +828,49 @@ class VescUart
          */
         void sendKeepalive(uint8_t canId);
 
+        /**
+         * @brief      Change the runtime limits of the motor without a full configuration write
+         * @param      limits  - The limits to apply
+         * @param      store   - Also store the limits in flash (avoid for frequent changes)
+         * @param      ack     - Wait for the VESC to acknowledge the limits
+         *
+         * @return     True if sent (and acknowledged if ack is set)
+         */
+        bool setMcconfTemp(const mcconfTempPackage & limits, bool store, bool ack);
+
+        /**
+         * @brief      Change the runtime limits of the motor without a full configuration write
+         * @param      limits  - The limits to apply
+         * @param      store   - Also store the limits in flash (avoid for frequent changes)
+         * @param      ack     - Wait for the VESC to acknowledge the limits
+         * @param      canId   - The CAN ID of the VESC
+         *
+         * @return     True if sent (and acknowledged if ack is set)
+         */
+        bool setMcconfTemp(const mcconfTempPackage & limits, bool store, bool ack, uint8_t canId);
+
+        /**
+         * @brief      Change the runtime limits of every VESC on the CAN bus with a single frame.
+         *             The local VESC converts the speed limits (m/s) to ERPM and forwards the limits.
+         * @param      limits               - The limits to apply, with erpmMin/erpmMax as speed in m/s
+         * @param      store                - Also store the limits in flash (avoid for frequent changes)
+         * @param      ack                  - Wait for the local VESC to acknowledge the limits
+         * @param      divideByControllers  - Split the watt limits between the VESCs on the bus
+         *
+         * @return     True if sent (and acknowledged if ack is set)
+         */
+        bool setMcconfTempSetup(const mcconfTempPackage & limits, bool store, bool ack, bool divideByControllers);
+
         /**
          * @brief      Help Function to print struct dataPackage over Serial for Debug
          */
         void printVescValues(void);
 
+        /**
+         * @brief      Help Function to print struct extendedDataPackage over Serial for Debug
+         */
+        void printVescValuesExtended(void);
+
 	private: 
 
 		/** Variabel to hold the reference to the Serial object to use for UART */
@@ -190,6 +880,58 @@ class VescUart
 		  * Uses the class Stream instead of HarwareSerial */
 		Stream* debugPort = NULL;
 
+		/** Firmware versions of the controllers seen so far */
+		FWcacheEntry fwCache[VESCUART_FW_CACHE_SIZE];
+
+		/** Next cache entry to evict when the cache is full */
+		uint8_t fwCacheNext = 0;
+
+		/** Receive state of the incremental UART parser */
+		uint8_t rxBuffer[VESCUART_RX_BUFFER_SIZE];
+		uint8_t rxFooter[3];
+		uint16_t rxCounter = 0;
+		uint16_t rxHeaderLen = 0;
+		uint16_t rxLenPayload = 0;
+		uint32_t rxStart_us = 0;	// micros() at the start byte of the message in rxBuffer
+		uint32_t rxByteTime_ns = 0;	// Transfer time of a byte, 0 if the baud rate is not known
+
+		/** Send times of values requests waiting for their reply */
+		struct pendingRequest {
+			bool used;
+			uint8_t canId;
+			uint32_t sent_us;
+		};
+		pendingRequest pending[VESCUART_MAX_PENDING];
+
+		/** CAN ID of the last non-blocking request, used in update() for replies that do not tell who sent them */
+		uint8_t requestCanId = 0;
+
+		/** Where to decode the next COMM_BMS_GET_VALUES reply */
+		bmsPackage * bmsTarget = NULL;
+
+		/** Where to decode the next COMM_LISP_GET_STATS reply */
+		lispStatsPackage * lispStatsTarget = NULL;
+
+		/** Where to decode the next COMM_GET_STATS reply */
+		statsPackage * statsTarget = NULL;
+
+		/** Dispatch table: index + 1 into handlers for each packet id, 0 if none */
+		uint8_t handlerIndex[VESCUART_PACKET_ID_COUNT];
+		handlerEntry handlers[VESCUART_MAX_HANDLERS];
+
+		/** Handler for COMM_CUSTOM_APP_DATA messages */
+		customAppDataHandler customAppDataCallback = NULL;
+		void * customAppDataContext = NULL;
+
+		/** Called with every decoded values reply */
+		valuesHandler valuesCallback = NULL;
+		void * valuesContext = NULL;
+
+		/** Ring buffer with text received in COMM_PRINT and COMM_LISP_PRINT messages */
+		char printBuffer[VESCUART_PRINT_BUFFER_SIZE];
+		uint16_t printHead = 0;
+		uint16_t printTail = 0;
+
 		/**
 		 * @brief      Packs the payload and sends it over Serial
 		 *
@@ -200,30 +942,256 @@ class VescUart
 		int packSendPayload(uint8_t * payload, int lenPay);
 
 		/**
-		 * @brief      Receives the message over Serial
+		 * @brief      Packs the payload and sends it over Serial, forwarded over CAN if canId is not 0.
+		 *             Payloads longer than 255 bytes are sent with the 3 byte header.
+		 *
+		 * @param      payload  - The payload as a unit8_t Array with length of int lenPayload
+		 * @param      lenPay   - Length of payload
+		 * @param      canId    - The CAN ID of the VESC
+		 * @return     The number of bytes send
+		 */
+		int packSendPayload(uint8_t * payload, int lenPay, uint8_t canId);
+
+		/**
+		 * @brief      Packs a packet id and its data and sends it over Serial without copying the data
+		 *
+		 * @param      packetId  - The packet id, sent in front of the data
+		 * @param      data      - The data
+		 * @param      len       - Length of data
+		 * @param      canId     - The CAN ID of the VESC
+		 * @return     The number of bytes send
+		 */
+		int packSendPacket(uint8_t packetId, const uint8_t * data, int len, uint8_t canId);
+
+		/**
+		 * @brief      Waits for the reply to a request, which is left in rxBuffer. Other messages
+		 *             received in the meantime are passed to their handlers.
+		 *
+		 * @param      packetId    - The packet id of the reply
+		 * @param      canId       - The CAN ID the request was sent to
+		 * @param      timeout_ms  - How long to wait for the reply
+		 * @return     The length of the reply, 0 on timeout
+		 */
+		int waitForPacket(uint8_t packetId, uint8_t canId, uint32_t timeout_ms);
+
+		/**
+		 * @brief      Checks that the reply in rxBuffer was sent by the controller the request was
+		 *             sent to, as far as the reply tells
+		 *
+		 * @param      canId  - The CAN ID the request was sent to
+		 * @param      len    - Length of the reply
+		 * @return     False if the reply is from another controller
+		 */
+		bool isReplyFrom(uint8_t canId, int len);
+
+		/**
+		 * @brief      Finds the controller that sent a reply which arrived without a blocking request
+		 *
+		 * @param      message  - The payload, starting with the packet id
+		 * @param      len      - Length of the payload
+		 * @return     The CAN ID from the controller id in a values reply, 0 for the controller on
+		 *             the UART, or requestCanId if the reply has no controller id
+		 */
+		uint8_t replySender(uint8_t * message, int len);
+
+		/**
+		 * @brief      Finds the controller id in a values reply
+		 *
+		 * @param      message  - The payload, starting with the packet id
+		 * @param      len      - Length of the payload
+		 * @return     Index of the id in the payload, -1 if the reply has none
+		 */
+		int replyIdIndex(uint8_t * message, int len);
+
+		/**
+		 * @brief      Checks if a controller id from a reply is one of the CAN controllers talked
+		 *             to: one with a values request waiting or with its firmware in the cache.
+		 *             isReplyFrom() and replySender() both attribute replies by it.
+		 *
+		 * @param      id  - The controller id
+		 * @return     True for a CAN controller, false for the one on the UART
+		 */
+		bool isCanController(uint8_t id);
+
+		/**
+		 * @brief      Reads the available bytes without blocking until a message is complete
 		 *
-		 * @param      payloadReceived  - The received payload as a unit8_t Array
-		 * @return     The number of bytes receeived within the payload
+		 * @return     The length of the payload in rxBuffer if a message is complete, otherwise 0
 		 */
-		int receiveUartMessage(uint8_t * payloadReceived);
+		int pollUartMessage(void);
 
 		/**
-		 * @brief      Verifies the message (CRC-16) and extracts the payload
+		 * @brief      Verifies the payload against the received CRC-16
 		 *
-		 * @param      message  - The received UART message
-		 * @param      lenMes   - The lenght of the message
-		 * @param      payload  - The final payload ready to extract data from
+		 * @param      payload  - The received payload
+		 * @param      lenPay   - The lenght of the payload
+		 * @param      footer   - The CRC-16 and stop byte following the payload
 		 * @return     True if the process was a success
 		 */
-		bool unpackPayload(uint8_t * message, int lenMes, uint8_t * payload);
+		bool unpackPayload(uint8_t * payload, int lenPay, uint8_t * footer);
 
 		/**
-		 * @brief      Extracts the data from the received payload
+		 * @brief      Passes the received payload to the handler of its packet id
 		 *
 		 * @param      message  - The payload to extract data from
+		 * @param      len      - Length of the payload
+		 * @param      canId    - The CAN ID the request was sent to
 		 * @return     True if the process was a success
 		 */
-		bool processReadPacket(uint8_t * message);
+		bool processReadPacket(uint8_t * message, int len, uint8_t canId);
+
+		/**
+		 * @brief      Built-in packet handlers, context is the VescUart instance
+		 */
+		static bool handleFWversion(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleValues(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleValuesSelective(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleImuData(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleBmsValues(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleLispStats(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleStats(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handleCustomAppData(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static bool handlePrint(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+
+		/**
+		 * @brief      Decodes a COMM_FW_VERSION reply into fw_version and the firmware cache
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @param      canId    - The CAN ID the request was sent to
+		 * @return     True if the reply was complete
+		 */
+		bool decodeFWversion(uint8_t * message, int len, uint8_t canId);
+
+		/**
+		 * @brief      Decodes a COMM_GET_VALUES reply into dataRaw
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @param      layout   - Layout matching the firmware of the sender
+		 * @return     True if all fields required by the layout were present
+		 */
+		bool decodeValues(uint8_t * message, int len, valuesLayout layout);
+
+		/**
+		 * @brief      Decodes a COMM_GET_VALUES_SELECTIVE reply into dataRaw
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @return     True if all fields selected by the mask were present
+		 */
+		bool decodeValuesSelective(uint8_t * message, int len);
+
+		/**
+		 * @brief      Decodes the telemetry fields in mask, which must all be present, into dataRaw
+		 *
+		 * @param      message  - The fields
+		 * @param      mask     - The fields present, as a COMM_GET_VALUES_SELECTIVE mask
+		 */
+		void decodeValueFields(uint8_t * message, uint32_t mask);
+
+		/**
+		 * @brief      Remembers the send time of a values request
+		 * @param      canId  - The CAN ID the request went to
+		 */
+		void addPending(uint8_t canId);
+
+		/**
+		 * @brief      Sets the receive and send time of the values reply just decoded into dataRaw
+		 * @param      canId  - The CAN ID the reply is attributed to
+		 */
+		void stampValues(uint8_t canId);
+
+		/**
+		 * @brief      Decodes a COMM_GET_IMU_DATA reply into imu
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @return     True if all fields selected by the mask were present
+		 */
+		bool decodeImuData(uint8_t * message, int len);
+
+		/**
+		 * @brief      Decodes a COMM_BMS_GET_VALUES reply into bmsTarget
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @return     True if the reply was complete
+		 */
+		bool decodeBmsValues(uint8_t * message, int len);
+
+		/**
+		 * @brief      Decodes a COMM_LISP_GET_STATS reply into lispStatsTarget
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @return     True if the reply was complete
+		 */
+		bool decodeLispStats(uint8_t * message, int len);
+
+		/**
+		 * @brief      Decodes a COMM_GET_STATS reply into statsTarget
+		 *
+		 * @param      message  - The payload without the packet id
+		 * @param      len      - Length of the payload without the packet id
+		 * @return     True if all fields selected by the mask were present
+		 */
+		bool decodeStats(uint8_t * message, int len);
+
+		/**
+		 * @brief      Sends a string command, e.g. COMM_TERMINAL_CMD
+		 *
+		 * @param      packetId  - The command
+		 * @param      str       - The null-terminated string
+		 * @param      canId     - The CAN ID of the VESC
+		 */
+		void sendString(COMM_PACKET_ID packetId, const char * str, uint8_t canId);
+
+		/**
+		 * @brief      Finds the firmware cache entry of a controller
+		 *
+		 * @param      canId   - The CAN ID of the VESC
+		 * @param      create  - Allocate an entry if none exists, evicting one of a controller that did not answer
+		 * @return     Pointer to the entry, or NULL if not found or the cache is full
+		 */
+		FWcacheEntry * findFWcacheEntry(uint8_t canId, bool create);
+
+		/**
+		 * @brief      Returns the COMM_GET_VALUES layout of a controller from the cache
+		 *
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     The layout to decode replies with
+		 */
+		valuesLayout getValuesLayout(uint8_t canId);
+
+		/**
+		 * @brief      Returns the fields a COMM_GET_VALUES reply of a controller holds, from the cache
+		 *
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     The fields as a COMM_GET_VALUES_SELECTIVE mask
+		 */
+		uint32_t getValuesFields(uint8_t canId);
+
+		/**
+		 * @brief      Queries the firmware version of a controller if it is not cached yet
+		 *
+		 * @param      canId  - The CAN ID of the VESC
+		 */
+		void queryFWversionOnce(uint8_t canId);
+
+		/**
+		 * @brief      Sends COMM_SET_MCCONF_TEMP or COMM_SET_MCCONF_TEMP_SETUP
+		 *
+		 * @param      packetId  - The command to send
+		 * @param      limits    - The limits to apply
+		 * @param      store     - Also store the limits in flash
+		 * @param      forward   - Let the VESC forward the limits to the CAN bus
+		 * @param      ack       - Wait for the VESC to acknowledge the limits
+		 * @param      divide    - Split the watt limits between the VESCs on the bus
+		 * @param      canId     - The CAN ID of the VESC
+		 * @return     True if sent (and acknowledged if ack is set)
+		 */
+		bool sendMcconfTemp(COMM_PACKET_ID packetId, const mcconfTempPackage & limits, bool store, bool forward, bool ack, bool divide, uint8_t canId);
 
 		/**
 		 * @brief      Help Function to print uint8_t array over Serial for Debug
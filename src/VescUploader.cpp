@@ -0,0 +1,352 @@
+#include "VescUploader.h"
+
+// The compressed variant of a write command, or the command itself if it has none
+static uint8_t lzoPacketId(COMM_PACKET_ID packetId) {
+	switch (packetId) {
+		case COMM_WRITE_NEW_APP_DATA:
+			return COMM_WRITE_NEW_APP_DATA_LZO;
+		case COMM_WRITE_NEW_APP_DATA_ALL_CAN:
+			return COMM_WRITE_NEW_APP_DATA_ALL_CAN_LZO;
+		default:
+			return packetId;
+	}
+}
+
+VescUploader::VescUploader(VescUart & uart) : uart(uart) {
+	for (int i = 0; i < VESCUPLOADER_WINDOW; i++) {
+		slots[i].used = false;
+	}
+}
+
+void VescUploader::setProgressCallback(progressCallback callback) {
+	progress = callback;
+}
+
+void VescUploader::setCompression(bool enable) {
+	compression = enable;
+}
+
+bool VescUploader::upload(Stream & image, uint32_t size) {
+	return upload(image, size, 0);
+}
+
+bool VescUploader::upload(Stream & image, uint32_t size, uint8_t canId) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_ERASE_NEW_APP "+String(canId));
+	}
+
+	bool lzo = compression && supportsLzo(canId);
+	return write(image, size, COMM_ERASE_NEW_APP, COMM_WRITE_NEW_APP_DATA, VESCUPLOADER_ERASE_TIMEOUT, false, lzo, canId);
+}
+
+bool VescUploader::uploadAllCan(Stream & image, uint32_t size) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_ERASE_NEW_APP_ALL_CAN");
+	}
+
+	bool lzo = compression && supportsLzo(0);
+	return write(image, size, COMM_ERASE_NEW_APP_ALL_CAN, COMM_WRITE_NEW_APP_DATA_ALL_CAN, VESCUPLOADER_ERASE_ALL_CAN_TIMEOUT, false, lzo, 0);
+}
+
+bool VescUploader::uploadLisp(Stream & code, uint32_t size) {
+	return uploadLisp(code, size, 0);
+}
+
+bool VescUploader::uploadLisp(Stream & code, uint32_t size, uint8_t canId) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_LISP_ERASE_CODE "+String(canId));
+	}
+
+	// The code is stored as a null-terminated string
+	return write(code, size, COMM_LISP_ERASE_CODE, COMM_LISP_WRITE_CODE, VESCUPLOADER_ERASE_TIMEOUT, true, false, canId);
+}
+
+bool VescUploader::eraseLisp(void) {
+	return eraseLisp(0);
+}
+
+bool VescUploader::eraseLisp(uint8_t canId) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_LISP_ERASE_CODE "+String(canId));
+	}
+
+	// A negative size erases the whole code area
+	int32_t index = 0;
+	uint8_t payload[5];
+	payload[index++] = COMM_LISP_ERASE_CODE;
+	buffer_append_int32(payload, -1, &index);
+
+	return command(payload, index, VESCUPLOADER_ERASE_TIMEOUT, canId);
+}
+
+void VescUploader::jumpToBootloader(void) {
+	jumpToBootloader(0);
+}
+
+void VescUploader::jumpToBootloader(uint8_t canId) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_JUMP_TO_BOOTLOADER "+String(canId));
+	}
+
+	uint8_t payload[1] = { COMM_JUMP_TO_BOOTLOADER };
+	uart.packSendPayload(payload, 1, canId);
+}
+
+void VescUploader::jumpToBootloaderAllCan(void) {
+
+	if (uart.debugPort != NULL) {
+		uart.debugPort->println("Command: COMM_JUMP_TO_BOOTLOADER_ALL_CAN");
+	}
+
+	uint8_t payload[1] = { COMM_JUMP_TO_BOOTLOADER_ALL_CAN };
+	uart.packSendPayload(payload, 1, 0);
+}
+
+float VescUploader::bytesPerSecond(void) {
+	if (elapsed_ms == 0) {
+		return 0;
+	}
+	return bytesWritten * 1000.0f / elapsed_ms;
+}
+
+float VescUploader::compressionRatio(void) {
+	if (bytesSent == 0) {
+		return 1.0f;
+	}
+	return (float)bytesRead / bytesSent;
+}
+
+bool VescUploader::write(Stream & image, uint32_t size, COMM_PACKET_ID eraseId, COMM_PACKET_ID writeId, uint32_t eraseTimeout, bool terminate, bool lzo, uint8_t canId) {
+
+	// The flash area starts with the image size and CRC, followed by the image:
+	// [uint32 size][uint16 crc16][image]. The header is written last, as the CRC is only
+	// known once the whole image has been read.
+	uint32_t total = size + (terminate ? 1 : 0);
+	uint32_t offset = 6;
+	uint32_t remaining = total;
+	uint16_t crc = 0;
+	int32_t index = 0;
+
+	start = millis();
+	bytesWritten = 0;
+	bytesRead = 0;
+	bytesSent = 0;
+	bytesTotal = total;
+	elapsed_ms = 0;
+	retransmissions = 0;
+	ackOffsets = false;
+	for (int i = 0; i < VESCUPLOADER_WINDOW; i++) {
+		slots[i].used = false;
+	}
+
+	uint8_t erase[5];
+	erase[index++] = eraseId;
+	buffer_append_uint32(erase, total + 6, &index);
+
+	if (!command(erase, index, eraseTimeout, canId)) {
+		return false;
+	}
+
+	while (remaining > 0 || inFlight() > 0) {
+
+		// Keep the window full. Acknowledgements without the offset can only be matched to the
+		// write in flight, so until one with the offset arrives there is just one.
+		int window = ackOffsets ? VESCUPLOADER_WINDOW : 1;
+		for (int i = 0; i < window && remaining > 0; i++) {
+			chunkSlot * slot = &slots[i];
+			if (slot->used) {
+				continue;
+			}
+
+			int len = remaining < VESCUPLOADER_CHUNK_SIZE ? remaining : VESCUPLOADER_CHUNK_SIZE;
+			int lenImage = (terminate && (uint32_t)len == remaining) ? len - 1 : len;
+			if ((int)image.readBytes(slot->payload + 5, lenImage) != lenImage) {
+				if (uart.debugPort != NULL) {
+					uart.debugPort->println("Image is shorter than its size");
+				}
+				return false;
+			}
+			if (lenImage < len) {
+				slot->payload[5 + lenImage] = 0;
+			}
+			crc = crc16_continue(crc, slot->payload + 5, len);
+
+			fillSlot(slot, writeId, offset, len, lzo);
+			sendSlot(slot, canId);
+
+			offset += len;
+			remaining -= len;
+		}
+
+		if (!receiveAck(writeId, canId)) {
+			return false;
+		}
+	}
+
+	// Header
+	chunkSlot * slot = &slots[0];
+	index = 5;
+	buffer_append_uint32(slot->payload, total, &index);
+	buffer_append_uint16(slot->payload, crc, &index);
+	fillSlot(slot, writeId, 0, 6, false);
+	sendSlot(slot, canId);
+
+	while (inFlight() > 0) {
+		if (!receiveAck(writeId, canId)) {
+			return false;
+		}
+	}
+
+	elapsed_ms = millis() - start;
+	return true;
+}
+
+void VescUploader::fillSlot(chunkSlot * slot, COMM_PACKET_ID packetId, uint32_t offset, int len, bool lzo) {
+
+	int32_t index = 0;
+
+	slot->offset = offset;
+	slot->dataLen = len;
+	slot->retries = 0;
+
+#if VESCUPLOADER_LZO
+	// [packet id][offset][uint16 decompressed length][compressed data], only if smaller than the plain chunk
+	if (lzo && lzoPacketId(packetId) != packetId) {
+		int32_t lzoLen = lzo1x_1_compress(slot->payload + 5, len, lzoBuffer, len - 3, lzoWrkmem);
+		if (lzoLen > 0) {
+			slot->payload[index++] = lzoPacketId(packetId);
+			buffer_append_uint32(slot->payload, offset, &index);
+			buffer_append_uint16(slot->payload, len, &index);
+			memcpy(slot->payload + index, lzoBuffer, lzoLen);
+			slot->len = index + lzoLen;
+			bytesRead += len;
+			bytesSent += lzoLen + 2;
+			return;
+		}
+	}
+#else
+	(void)lzo;
+#endif
+
+	// [packet id][offset][data]
+	slot->payload[index++] = packetId;
+	buffer_append_uint32(slot->payload, offset, &index);
+	slot->len = index + len;
+	bytesRead += len;
+	bytesSent += len;
+}
+
+bool VescUploader::supportsLzo(uint8_t canId) {
+#if VESCUPLOADER_LZO
+	uart.queryFWversionOnce(canId);
+	const VescUart::FWversionPackage * fw = uart.getCachedFWversion(canId);
+	return fw != NULL && (fw->major > 5 || (fw->major == 5 && fw->minor >= 2));
+#else
+	(void)canId;
+	return false;
+#endif
+}
+
+bool VescUploader::command(uint8_t * payload, int len, uint32_t timeout_ms, uint8_t canId) {
+
+	uart.packSendPayload(payload, len, canId);
+
+	int lenPayload = uart.waitForPacket(payload[0], canId, timeout_ms);
+
+	return lenPayload >= 2 && uart.rxBuffer[1];
+}
+
+void VescUploader::sendSlot(chunkSlot * slot, uint8_t canId) {
+	slot->used = true;
+	slot->sentAt = millis();
+	uart.packSendPayload(slot->payload, slot->len, canId);
+}
+
+bool VescUploader::receiveAck(COMM_PACKET_ID packetId, uint8_t canId) {
+
+	// Wait until the oldest write in flight times out
+	chunkSlot * oldest = NULL;
+	for (int i = 0; i < VESCUPLOADER_WINDOW; i++) {
+		if (slots[i].used && (oldest == NULL || (int32_t)(slots[i].sentAt - oldest->sentAt) < 0)) {
+			oldest = &slots[i];
+		}
+	}
+	if (oldest == NULL) {
+		return true;
+	}
+
+	while ((int32_t)(millis() - oldest->sentAt) < VESCUPLOADER_ACK_TIMEOUT) {
+		int lenPayload = uart.pollUartMessage();
+		if (lenPayload <= 0) {
+			continue;
+		}
+
+		uint8_t * message = uart.rxBuffer;
+		// The LZO variants are acknowledged like the plain ones, but accept both
+		if (message[0] != packetId && message[0] != lzoPacketId(packetId)) {
+			uart.processReadPacket(message, lenPayload, uart.replySender(message, lenPayload));
+			continue;
+		}
+
+		if (lenPayload < 2 || !message[1]) {
+			if (uart.debugPort != NULL) {
+				uart.debugPort->println("Write failed");
+			}
+			return false;
+		}
+
+		// Firmware before 5.x does not send the offset. Only one write is in flight then, but a
+		// late acknowledgement of a write that was sent again is still taken for the next one.
+		chunkSlot * slot = oldest;
+		if (lenPayload >= 6) {
+			ackOffsets = true;
+			int32_t index = 2;
+			uint32_t offset = buffer_get_uint32(message, &index);
+			slot = NULL;
+			for (int i = 0; i < VESCUPLOADER_WINDOW; i++) {
+				if (slots[i].used && slots[i].offset == offset) {
+					slot = &slots[i];
+				}
+			}
+			if (slot == NULL) {
+				continue; // Acknowledgement of a write that was sent again
+			}
+		}
+
+		slot->used = false;
+		if (slot->offset != 0) {
+			bytesWritten += slot->dataLen;
+		}
+		elapsed_ms = millis() - start;
+		if (progress != NULL) {
+			progress(bytesWritten, bytesTotal);
+		}
+		return true;
+	}
+
+	if (++oldest->retries > VESCUPLOADER_RETRIES) {
+		if (uart.debugPort != NULL) {
+			uart.debugPort->println("Timeout");
+		}
+		return false;
+	}
+
+	retransmissions++;
+	sendSlot(oldest, canId);
+	return true;
+}
+
+int VescUploader::inFlight(void) {
+	int count = 0;
+	for (int i = 0; i < VESCUPLOADER_WINDOW; i++) {
+		if (slots[i].used) {
+			count++;
+		}
+	}
+	return count;
+}
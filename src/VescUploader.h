@@ -0,0 +1,287 @@
+#ifndef _VESCUPLOADER_h
+#define _VESCUPLOADER_h
+
+#include "VescUart.h"
+#include "lzo1x.h"
+
+/** Bytes of firmware per write packet. The VESC accepts packets up to 512 bytes. */
+#ifndef VESCUPLOADER_CHUNK_SIZE
+#if defined(__AVR__)
+#define VESCUPLOADER_CHUNK_SIZE 128
+#else
+#define VESCUPLOADER_CHUNK_SIZE 384
+#endif
+#endif
+
+/** Number of write packets sent before waiting for the first acknowledgement. Only used once the
+    firmware has shown that its acknowledgements carry the offset, otherwise one is in flight. */
+#ifndef VESCUPLOADER_WINDOW
+#if defined(__AVR__)
+#define VESCUPLOADER_WINDOW 1
+#else
+#define VESCUPLOADER_WINDOW 4
+#endif
+#endif
+
+/** Compress chunks with LZO1X when that makes them smaller. Needs about 2.5 kB of RAM. */
+#ifndef VESCUPLOADER_LZO
+#if defined(__AVR__)
+#define VESCUPLOADER_LZO 0
+#else
+#define VESCUPLOADER_LZO 1
+#endif
+#endif
+
+/** How long to wait for the flash to be erased. Erasing all controllers on the CAN bus takes longer. */
+#ifndef VESCUPLOADER_ERASE_TIMEOUT
+#define VESCUPLOADER_ERASE_TIMEOUT 10000
+#endif
+#ifndef VESCUPLOADER_ERASE_ALL_CAN_TIMEOUT
+#define VESCUPLOADER_ERASE_ALL_CAN_TIMEOUT 30000
+#endif
+
+/** How long to wait for a write to be acknowledged before sending it again, and how often */
+#ifndef VESCUPLOADER_ACK_TIMEOUT
+#define VESCUPLOADER_ACK_TIMEOUT 1000
+#endif
+#ifndef VESCUPLOADER_RETRIES
+#define VESCUPLOADER_RETRIES 3
+#endif
+
+class VescUploader
+{
+	/** A write packet waiting for its acknowledgement. The payload is kept so it can be sent again. */
+	struct chunkSlot {
+		bool used;
+		uint8_t retries;
+		uint32_t offset;
+		uint32_t sentAt;
+		uint16_t dataLen;					// Image bytes in the chunk
+		int len;							// Length of payload
+		uint8_t payload[5 + VESCUPLOADER_CHUNK_SIZE];	// Packet id, offset and data
+	};
+
+	public:
+		/** Called after every acknowledged write with the number of bytes written and the total */
+		typedef void (*progressCallback)(uint32_t written, uint32_t total);
+
+		/**
+		 * @brief      Class constructor
+		 * @param      uart  - The VescUart instance used to talk to the VESC
+		 */
+		VescUploader(VescUart & uart);
+
+		/**
+		 * @brief      Set the function called to report progress
+		 * @param      callback  - The function, or NULL
+		 */
+		void setProgressCallback(progressCallback callback);
+
+		/**
+		 * @brief      Enable or disable LZO compression of the chunks. It is only used if the
+		 *             firmware supports it (5.02 and newer) and a chunk gets smaller.
+		 * @param      enable  - True to compress, the default
+		 */
+		void setCompression(bool enable);
+
+		/**
+		 * @brief      Erase the new app area and write a firmware image to it. The image is read
+		 *             from the stream in chunks, so it never has to fit in RAM.
+		 *
+		 * @param      image  - Stream with the firmware image (.bin), e.g. a file on an SD card
+		 * @param      size   - Size of the image in bytes
+		 * @return     True if the whole image was written and acknowledged
+		 */
+		bool upload(Stream & image, uint32_t size);
+
+		/**
+		 * @brief      Erase the new app area and write a firmware image to it
+		 *
+		 * @param      image  - Stream with the firmware image (.bin), e.g. a file on an SD card
+		 * @param      size   - Size of the image in bytes
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if the whole image was written and acknowledged
+		 */
+		bool upload(Stream & image, uint32_t size, uint8_t canId);
+
+		/**
+		 * @brief      Write a firmware image to the VESC and every controller on its CAN bus
+		 *             (COMM_ERASE_NEW_APP_ALL_CAN / COMM_WRITE_NEW_APP_DATA_ALL_CAN)
+		 *
+		 * @param      image  - Stream with the firmware image (.bin), e.g. a file on an SD card
+		 * @param      size   - Size of the image in bytes
+		 * @return     True if the whole image was written and acknowledged
+		 */
+		bool uploadAllCan(Stream & image, uint32_t size);
+
+		/**
+		 * @brief      Erase the LispBM code and write a new script. Stop the running script with
+		 *             VescUart::setLispRunning() first and start it again afterwards.
+		 *
+		 * @param      code  - Stream with the script source
+		 * @param      size  - Size of the script in bytes
+		 * @return     True if the whole script was written and acknowledged
+		 */
+		bool uploadLisp(Stream & code, uint32_t size);
+
+		/**
+		 * @brief      Erase the LispBM code and write a new script
+		 *
+		 * @param      code   - Stream with the script source
+		 * @param      size   - Size of the script in bytes
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if the whole script was written and acknowledged
+		 */
+		bool uploadLisp(Stream & code, uint32_t size, uint8_t canId);
+
+		/**
+		 * @brief      Erase the LispBM code
+		 *
+		 * @return     True if the VESC acknowledged it
+		 */
+		bool eraseLisp(void);
+
+		/**
+		 * @brief      Erase the LispBM code
+		 * @param      canId  - The CAN ID of the VESC
+		 *
+		 * @return     True if the VESC acknowledged it
+		 */
+		bool eraseLisp(uint8_t canId);
+
+		/**
+		 * @brief      Start the bootloader, which installs the uploaded firmware and reboots
+		 */
+		void jumpToBootloader(void);
+
+		/**
+		 * @brief      Start the bootloader, which installs the uploaded firmware and reboots
+		 * @param      canId  - The CAN ID of the VESC
+		 */
+		void jumpToBootloader(uint8_t canId);
+
+		/**
+		 * @brief      Start the bootloader on the VESC and every controller on its CAN bus
+		 */
+		void jumpToBootloaderAllCan(void);
+
+		/**
+		 * @brief      Throughput of the last upload
+		 *
+		 * @return     Image bytes written per second
+		 */
+		float bytesPerSecond(void);
+
+		/**
+		 * @brief      Compression ratio of the last upload
+		 *
+		 * @return     Image bytes divided by the bytes of chunk data sent, 1.0 without compression
+		 */
+		float compressionRatio(void);
+
+		/** Image bytes acknowledged so far and the image size of the current or last upload */
+		uint32_t bytesWritten = 0;
+		uint32_t bytesTotal = 0;
+
+		/** Duration of the last upload, including the erase */
+		uint32_t elapsed_ms = 0;
+
+		/** Bytes of chunk data sent, compressed or not, without retransmissions */
+		uint32_t bytesSent = 0;
+
+		/** Number of write packets sent again because their acknowledgement did not arrive */
+		uint32_t retransmissions = 0;
+
+	private:
+
+		/** Variabel to hold the reference to the VescUart instance */
+		VescUart & uart;
+
+		progressCallback progress = NULL;
+
+		/** Image bytes put into chunks so far */
+		uint32_t bytesRead = 0;
+
+		/** When the current upload started */
+		uint32_t start = 0;
+
+		bool compression = true;
+
+		/** The acknowledgements of this upload carry the offset of the write, so several can be in flight */
+		bool ackOffsets = false;
+
+#if VESCUPLOADER_LZO
+		/** LZO1X dictionary and output buffer */
+		uint16_t lzoWrkmem[LZO1X_WRKMEM_SIZE];
+		uint8_t lzoBuffer[VESCUPLOADER_CHUNK_SIZE];
+#endif
+
+		/** Write packets in flight */
+		chunkSlot slots[VESCUPLOADER_WINDOW];
+
+		/**
+		 * @brief      Erase and write an image, see upload()
+		 *
+		 * @param      image         - Stream with the image
+		 * @param      size          - Size of the image in bytes
+		 * @param      eraseId       - The erase command, e.g. COMM_ERASE_NEW_APP
+		 * @param      writeId       - The write command, e.g. COMM_WRITE_NEW_APP_DATA
+		 * @param      eraseTimeout  - How long to wait for the erase
+		 * @param      terminate     - Append a null byte to the image
+		 * @param      lzo           - Compress the chunks
+		 * @param      canId         - The CAN ID of the VESC
+		 * @return     True if the whole image was written and acknowledged
+		 */
+		bool write(Stream & image, uint32_t size, COMM_PACKET_ID eraseId, COMM_PACKET_ID writeId, uint32_t eraseTimeout, bool terminate, bool lzo, uint8_t canId);
+
+		/**
+		 * @brief      Sends a command and waits for its [packet id][bool ok] reply
+		 *
+		 * @param      payload     - The command
+		 * @param      len         - Length of the command
+		 * @param      timeout_ms  - How long to wait for the reply
+		 * @param      canId       - The CAN ID of the VESC
+		 * @return     True if the VESC replied ok
+		 */
+		bool command(uint8_t * payload, int len, uint32_t timeout_ms, uint8_t canId);
+
+		/**
+		 * @brief      Fills a slot with the next chunk of the image, compressed if that makes it smaller
+		 *
+		 * @param      slot      - The slot, with the image data already read to payload + 5
+		 * @param      packetId  - The write command
+		 * @param      offset    - Offset of the chunk in the new app area
+		 * @param      len       - Image bytes in the chunk
+		 * @param      lzo       - Try to compress the chunk, if the command has an LZO variant
+		 */
+		void fillSlot(chunkSlot * slot, COMM_PACKET_ID packetId, uint32_t offset, int len, bool lzo);
+
+		/**
+		 * @brief      Checks if the firmware of a controller accepts COMM_WRITE_NEW_APP_DATA_LZO
+		 *
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     True if it does
+		 */
+		bool supportsLzo(uint8_t canId);
+
+		/**
+		 * @brief      Sends the write packet in a slot and marks it in flight
+		 */
+		void sendSlot(chunkSlot * slot, uint8_t canId);
+
+		/**
+		 * @brief      Waits for the next acknowledgement and frees its slot. Writes that timed out are sent again.
+		 *
+		 * @param      packetId  - The write command
+		 * @param      canId     - The CAN ID of the VESC
+		 * @return     False if a write failed or was not acknowledged after all retries
+		 */
+		bool receiveAck(COMM_PACKET_ID packetId, uint8_t canId);
+
+		/**
+		 * @brief      Number of slots in flight
+		 */
+		int inFlight(void);
+};
+
+#endif
@@ -0,0 +1,778 @@
+#include "confgenerator.h"
+#include "buffer.h"
+
+// Generated layout of the firmware given in confgenerator.h: the field order and encodings
+// follow its parameter XML, not the order of the structs in datatypes.h. Overridden limits
+// that are computed at runtime (lo_*) and the flash crc are not part of the serialized config.
+
+int32_t confgenerator_serialize_mcconf(uint8_t *buffer, const mc_configuration *conf) {
+	int32_t ind = 0;
+
+	buffer_append_uint32(buffer, MCCONF_SIGNATURE, &ind);
+
+	buffer[ind++] = conf->pwm_mode;
+	buffer[ind++] = conf->comm_mode;
+	buffer[ind++] = conf->motor_type;
+	buffer[ind++] = conf->sensor_mode;
+	buffer_append_float32_auto(buffer, conf->l_current_max, &ind);
+	buffer_append_float32_auto(buffer, conf->l_current_min, &ind);
+	buffer_append_float32_auto(buffer, conf->l_in_current_max, &ind);
+	buffer_append_float32_auto(buffer, conf->l_in_current_min, &ind);
+	buffer_append_float32_auto(buffer, conf->l_abs_current_max, &ind);
+	buffer_append_float32_auto(buffer, conf->l_min_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->l_max_erpm, &ind);
+	buffer_append_float16(buffer, conf->l_erpm_start, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->l_max_erpm_fbrake, &ind);
+	buffer_append_float32_auto(buffer, conf->l_max_erpm_fbrake_cc, &ind);
+	buffer_append_float32_auto(buffer, conf->l_min_vin, &ind);
+	buffer_append_float32_auto(buffer, conf->l_max_vin, &ind);
+	buffer_append_float32_auto(buffer, conf->l_battery_cut_start, &ind);
+	buffer_append_float32_auto(buffer, conf->l_battery_cut_end, &ind);
+	buffer[ind++] = conf->l_slow_abs_current;
+	buffer_append_float16(buffer, conf->l_temp_fet_start, 10, &ind);
+	buffer_append_float16(buffer, conf->l_temp_fet_end, 10, &ind);
+	buffer_append_float16(buffer, conf->l_temp_motor_start, 10, &ind);
+	buffer_append_float16(buffer, conf->l_temp_motor_end, 10, &ind);
+	buffer_append_float16(buffer, conf->l_temp_accel_dec, 10000, &ind);
+	buffer_append_float16(buffer, conf->l_min_duty, 10000, &ind);
+	buffer_append_float16(buffer, conf->l_max_duty, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->l_watt_max, &ind);
+	buffer_append_float32_auto(buffer, conf->l_watt_min, &ind);
+	buffer_append_float16(buffer, conf->l_current_max_scale, 10000, &ind);
+	buffer_append_float16(buffer, conf->l_current_min_scale, 10000, &ind);
+	buffer_append_float16(buffer, conf->l_duty_start, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->sl_min_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->sl_min_erpm_cycle_int_limit, &ind);
+	buffer_append_float32_auto(buffer, conf->sl_max_fullbreak_current_dir_change, &ind);
+	buffer_append_float16(buffer, conf->sl_cycle_int_limit, 10, &ind);
+	buffer_append_float16(buffer, conf->sl_phase_advance_at_br, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->sl_cycle_int_rpm_br, &ind);
+	buffer_append_float32_auto(buffer, conf->sl_bemf_coupling_k, &ind);
+	buffer[ind++] = (uint8_t)conf->hall_table[0];
+	buffer[ind++] = (uint8_t)conf->hall_table[1];
+	buffer[ind++] = (uint8_t)conf->hall_table[2];
+	buffer[ind++] = (uint8_t)conf->hall_table[3];
+	buffer[ind++] = (uint8_t)conf->hall_table[4];
+	buffer[ind++] = (uint8_t)conf->hall_table[5];
+	buffer[ind++] = (uint8_t)conf->hall_table[6];
+	buffer[ind++] = (uint8_t)conf->hall_table[7];
+	buffer_append_float32_auto(buffer, conf->hall_sl_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_current_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_current_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_f_zv, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_dt_us, &ind);
+	buffer[ind++] = conf->foc_encoder_inverted;
+	buffer_append_float32_auto(buffer, conf->foc_encoder_offset, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_encoder_ratio, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_encoder_sin_gain, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_encoder_cos_gain, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_encoder_sin_offset, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_encoder_cos_offset, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_encoder_sincos_filter_constant, &ind);
+	buffer[ind++] = conf->foc_sensor_mode;
+	buffer_append_float32_auto(buffer, conf->foc_pll_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_pll_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_motor_l, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_motor_ld_lq_diff, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_motor_r, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_motor_flux_linkage, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_observer_gain, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_observer_gain_slow, &ind);
+	buffer_append_float16(buffer, conf->foc_observer_offset, 1000, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_duty_dowmramp_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_duty_dowmramp_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_openloop_rpm, &ind);
+	buffer_append_float16(buffer, conf->foc_openloop_rpm_low, 1000, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_d_gain_scale_start, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_d_gain_scale_max_mod, &ind);
+	buffer_append_float16(buffer, conf->foc_sl_openloop_hyst, 100, &ind);
+	buffer_append_float16(buffer, conf->foc_sl_openloop_time_lock, 100, &ind);
+	buffer_append_float16(buffer, conf->foc_sl_openloop_time_ramp, 100, &ind);
+	buffer_append_float16(buffer, conf->foc_sl_openloop_time, 100, &ind);
+	buffer_append_float16(buffer, conf->foc_sl_openloop_boost_q, 100, &ind);
+	buffer_append_float16(buffer, conf->foc_sl_openloop_max_q, 100, &ind);
+	buffer[ind++] = conf->foc_hall_table[0];
+	buffer[ind++] = conf->foc_hall_table[1];
+	buffer[ind++] = conf->foc_hall_table[2];
+	buffer[ind++] = conf->foc_hall_table[3];
+	buffer[ind++] = conf->foc_hall_table[4];
+	buffer[ind++] = conf->foc_hall_table[5];
+	buffer[ind++] = conf->foc_hall_table[6];
+	buffer[ind++] = conf->foc_hall_table[7];
+	buffer_append_float32_auto(buffer, conf->foc_hall_interp_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_sl_erpm, &ind);
+	buffer[ind++] = conf->foc_sample_v0_v7;
+	buffer[ind++] = conf->foc_sample_high_current;
+	buffer_append_float16(buffer, conf->foc_sat_comp, 1000, &ind);
+	buffer[ind++] = conf->foc_temp_comp;
+	buffer_append_float16(buffer, conf->foc_temp_comp_base_temp, 100, &ind);
+	buffer_append_float16(buffer, conf->foc_current_filter_const, 10000, &ind);
+	buffer[ind++] = conf->foc_cc_decoupling;
+	buffer[ind++] = conf->foc_observer_type;
+	buffer_append_float16(buffer, conf->foc_hfi_voltage_start, 10, &ind);
+	buffer_append_float16(buffer, conf->foc_hfi_voltage_run, 10, &ind);
+	buffer_append_float16(buffer, conf->foc_hfi_voltage_max, 10, &ind);
+	buffer_append_float16(buffer, conf->foc_hfi_gain, 1000, &ind);
+	buffer_append_float16(buffer, conf->foc_hfi_hyst, 100, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_sl_erpm_hfi, &ind);
+	buffer_append_uint16(buffer, conf->foc_hfi_start_samples, &ind);
+	buffer_append_float32_auto(buffer, conf->foc_hfi_obs_ovr_sec, &ind);
+	buffer[ind++] = conf->foc_hfi_samples;
+	buffer[ind++] = conf->foc_offsets_cal_on_boot;
+	buffer_append_float32_auto(buffer, conf->foc_offsets_current[0], &ind);
+	buffer_append_float32_auto(buffer, conf->foc_offsets_current[1], &ind);
+	buffer_append_float32_auto(buffer, conf->foc_offsets_current[2], &ind);
+	buffer_append_float16(buffer, conf->foc_offsets_voltage[0], 10000, &ind);
+	buffer_append_float16(buffer, conf->foc_offsets_voltage[1], 10000, &ind);
+	buffer_append_float16(buffer, conf->foc_offsets_voltage[2], 10000, &ind);
+	buffer_append_float16(buffer, conf->foc_offsets_voltage_undriven[0], 10000, &ind);
+	buffer_append_float16(buffer, conf->foc_offsets_voltage_undriven[1], 10000, &ind);
+	buffer_append_float16(buffer, conf->foc_offsets_voltage_undriven[2], 10000, &ind);
+	buffer[ind++] = conf->foc_phase_filter_enable;
+	buffer_append_float32_auto(buffer, conf->foc_phase_filter_max_erpm, &ind);
+	buffer[ind++] = conf->foc_mtpa_mode;
+	buffer_append_float32_auto(buffer, conf->foc_fw_current_max, &ind);
+	buffer_append_float16(buffer, conf->foc_fw_duty_start, 10000, &ind);
+	buffer_append_float16(buffer, conf->foc_fw_ramp_time, 1000, &ind);
+	buffer_append_float16(buffer, conf->foc_fw_q_current_factor, 10000, &ind);
+	buffer[ind++] = conf->foc_speed_soure;
+	buffer_append_int16(buffer, conf->gpd_buffer_notify_left, &ind);
+	buffer_append_int16(buffer, conf->gpd_buffer_interpol, &ind);
+	buffer_append_float16(buffer, conf->gpd_current_filter_const, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->gpd_current_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->gpd_current_ki, &ind);
+	buffer[ind++] = conf->sp_pid_loop_rate;
+	buffer_append_float32_auto(buffer, conf->s_pid_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->s_pid_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->s_pid_kd, &ind);
+	buffer_append_float16(buffer, conf->s_pid_kd_filter, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->s_pid_min_erpm, &ind);
+	buffer[ind++] = conf->s_pid_allow_braking;
+	buffer_append_float32_auto(buffer, conf->s_pid_ramp_erpms_s, &ind);
+	buffer_append_float32_auto(buffer, conf->p_pid_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->p_pid_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->p_pid_kd, &ind);
+	buffer_append_float32_auto(buffer, conf->p_pid_kd_proc, &ind);
+	buffer_append_float16(buffer, conf->p_pid_kd_filter, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->p_pid_ang_div, &ind);
+	buffer_append_float16(buffer, conf->p_pid_gain_dec_angle, 10, &ind);
+	buffer_append_float32_auto(buffer, conf->p_pid_offset, &ind);
+	buffer_append_float16(buffer, conf->cc_startup_boost_duty, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->cc_min_current, &ind);
+	buffer_append_float32_auto(buffer, conf->cc_gain, &ind);
+	buffer_append_float16(buffer, conf->cc_ramp_step_max, 10000, &ind);
+	buffer_append_int32(buffer, conf->m_fault_stop_time_ms, &ind);
+	buffer_append_float16(buffer, conf->m_duty_ramp_step, 10000, &ind);
+	buffer_append_float32_auto(buffer, conf->m_current_backoff_gain, &ind);
+	buffer_append_uint32(buffer, conf->m_encoder_counts, &ind);
+	buffer[ind++] = conf->m_sensor_port_mode;
+	buffer[ind++] = conf->m_invert_direction;
+	buffer[ind++] = conf->m_drv8301_oc_mode;
+	buffer[ind++] = conf->m_drv8301_oc_adj;
+	buffer_append_float32_auto(buffer, conf->m_bldc_f_sw_min, &ind);
+	buffer_append_float32_auto(buffer, conf->m_bldc_f_sw_max, &ind);
+	buffer_append_float32_auto(buffer, conf->m_dc_f_sw, &ind);
+	buffer_append_float32_auto(buffer, conf->m_ntc_motor_beta, &ind);
+	buffer[ind++] = conf->m_out_aux_mode;
+	buffer[ind++] = conf->m_motor_temp_sens_type;
+	buffer_append_float32_auto(buffer, conf->m_ptc_motor_coeff, &ind);
+	buffer[ind++] = conf->m_hall_extra_samples;
+	buffer_append_float16(buffer, conf->m_ntcx_ptcx_temp_base, 10, &ind);
+	buffer_append_float32_auto(buffer, conf->m_ntcx_ptcx_res, &ind);
+	buffer[ind++] = conf->si_motor_poles;
+	buffer_append_float32_auto(buffer, conf->si_gear_ratio, &ind);
+	buffer_append_float32_auto(buffer, conf->si_wheel_diameter, &ind);
+	buffer[ind++] = conf->si_battery_type;
+	buffer[ind++] = conf->si_battery_cells;
+	buffer_append_float32_auto(buffer, conf->si_battery_ah, &ind);
+	buffer_append_float32_auto(buffer, conf->si_motor_nl_current, &ind);
+	buffer[ind++] = conf->bms.type;
+	buffer_append_float16(buffer, conf->bms.t_limit_start, 100, &ind);
+	buffer_append_float16(buffer, conf->bms.t_limit_end, 100, &ind);
+	buffer_append_float16(buffer, conf->bms.soc_limit_start, 1000, &ind);
+	buffer_append_float16(buffer, conf->bms.soc_limit_end, 1000, &ind);
+	buffer[ind++] = conf->bms.fwd_can_mode;
+
+	return ind;
+}
+
+int32_t confgenerator_serialize_appconf(uint8_t *buffer, const app_configuration *conf) {
+	int32_t ind = 0;
+
+	buffer_append_uint32(buffer, APPCONF_SIGNATURE, &ind);
+
+	buffer[ind++] = conf->controller_id;
+	buffer_append_uint32(buffer, conf->timeout_msec, &ind);
+	buffer_append_float32_auto(buffer, conf->timeout_brake_current, &ind);
+	buffer_append_uint16(buffer, conf->can_status_rate_1, &ind);
+	buffer[ind++] = conf->can_status_msgs_r1;
+	buffer_append_uint16(buffer, conf->can_status_rate_2, &ind);
+	buffer[ind++] = conf->can_status_msgs_r2;
+	buffer[ind++] = conf->can_baud_rate;
+	buffer[ind++] = conf->pairing_done;
+	buffer[ind++] = conf->permanent_uart_enabled;
+	buffer[ind++] = conf->shutdown_mode;
+	buffer[ind++] = conf->servo_out_enable;
+	buffer[ind++] = conf->kill_sw_mode;
+	buffer[ind++] = conf->can_mode;
+	buffer[ind++] = conf->uavcan_esc_index;
+	buffer[ind++] = conf->uavcan_raw_mode;
+	buffer_append_float32_auto(buffer, conf->uavcan_raw_rpm_max, &ind);
+	buffer[ind++] = conf->app_to_use;
+	buffer[ind++] = conf->app_ppm_conf.ctrl_type;
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.pid_max_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.hyst, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.pulse_start, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.pulse_end, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.pulse_center, &ind);
+	buffer[ind++] = conf->app_ppm_conf.median_filter;
+	buffer[ind++] = conf->app_ppm_conf.safe_start;
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.throttle_exp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.throttle_exp_brake, &ind);
+	buffer[ind++] = conf->app_ppm_conf.throttle_exp_mode;
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.ramp_time_pos, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.ramp_time_neg, &ind);
+	buffer[ind++] = conf->app_ppm_conf.multi_esc;
+	buffer[ind++] = conf->app_ppm_conf.tc;
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.tc_max_diff, &ind);
+	buffer_append_float16(buffer, conf->app_ppm_conf.max_erpm_for_dir, 1, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.smart_rev_max_duty, &ind);
+	buffer_append_float32_auto(buffer, conf->app_ppm_conf.smart_rev_ramp_time, &ind);
+	buffer[ind++] = conf->app_adc_conf.ctrl_type;
+	buffer_append_float32_auto(buffer, conf->app_adc_conf.hyst, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage_start, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage_end, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage_min, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage_max, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage_center, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage2_start, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_adc_conf.voltage2_end, 1000, &ind);
+	buffer[ind++] = conf->app_adc_conf.use_filter;
+	buffer[ind++] = conf->app_adc_conf.safe_start;
+	buffer[ind++] = conf->app_adc_conf.cc_button_inverted;
+	buffer[ind++] = conf->app_adc_conf.rev_button_inverted;
+	buffer[ind++] = conf->app_adc_conf.voltage_inverted;
+	buffer[ind++] = conf->app_adc_conf.voltage2_inverted;
+	buffer_append_float32_auto(buffer, conf->app_adc_conf.throttle_exp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_adc_conf.throttle_exp_brake, &ind);
+	buffer[ind++] = conf->app_adc_conf.throttle_exp_mode;
+	buffer_append_float32_auto(buffer, conf->app_adc_conf.ramp_time_pos, &ind);
+	buffer_append_float32_auto(buffer, conf->app_adc_conf.ramp_time_neg, &ind);
+	buffer[ind++] = conf->app_adc_conf.multi_esc;
+	buffer[ind++] = conf->app_adc_conf.tc;
+	buffer_append_float32_auto(buffer, conf->app_adc_conf.tc_max_diff, &ind);
+	buffer_append_uint16(buffer, conf->app_adc_conf.update_rate_hz, &ind);
+	buffer_append_uint32(buffer, conf->app_uart_baudrate, &ind);
+	buffer[ind++] = conf->app_chuk_conf.ctrl_type;
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.hyst, &ind);
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.ramp_time_pos, &ind);
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.ramp_time_neg, &ind);
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.stick_erpm_per_s_in_cc, &ind);
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.throttle_exp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.throttle_exp_brake, &ind);
+	buffer[ind++] = conf->app_chuk_conf.throttle_exp_mode;
+	buffer[ind++] = conf->app_chuk_conf.multi_esc;
+	buffer[ind++] = conf->app_chuk_conf.tc;
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.tc_max_diff, &ind);
+	buffer[ind++] = conf->app_chuk_conf.use_smart_rev;
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.smart_rev_max_duty, &ind);
+	buffer_append_float32_auto(buffer, conf->app_chuk_conf.smart_rev_ramp_time, &ind);
+	buffer[ind++] = conf->app_nrf_conf.speed;
+	buffer[ind++] = conf->app_nrf_conf.power;
+	buffer[ind++] = conf->app_nrf_conf.crc_type;
+	buffer[ind++] = conf->app_nrf_conf.retry_delay;
+	buffer[ind++] = conf->app_nrf_conf.retries;
+	buffer[ind++] = conf->app_nrf_conf.channel;
+	buffer[ind++] = conf->app_nrf_conf.address[0];
+	buffer[ind++] = conf->app_nrf_conf.address[1];
+	buffer[ind++] = conf->app_nrf_conf.address[2];
+	buffer[ind++] = conf->app_nrf_conf.send_crc_ack;
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.kp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.ki, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.kd, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.hertz, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.loop_time_filter, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.fault_pitch, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.fault_roll, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.fault_duty, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.fault_adc1, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.fault_adc2, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.fault_delay_pitch, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.fault_delay_roll, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.fault_delay_duty, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.fault_delay_switch_half, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.fault_delay_switch_full, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.fault_adc_half_erpm, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_duty_angle, 100, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_duty_speed, 100, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_duty, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_hv_angle, 100, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_hv_speed, 100, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.tiltback_hv, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_lv_angle, 100, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_lv_speed, 100, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.tiltback_lv, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.tiltback_return_speed, 100, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.tiltback_constant, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.tiltback_constant_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.tiltback_variable, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.tiltback_variable_max, &ind);
+	buffer_append_float16(buffer, conf->app_balance_conf.noseangling_speed, 100, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.startup_pitch_tolerance, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.startup_roll_tolerance, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.startup_speed, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.deadzone, &ind);
+	buffer[ind++] = conf->app_balance_conf.multi_esc;
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.yaw_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.yaw_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.yaw_kd, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.roll_steer_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.roll_steer_erpm_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.brake_current, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.brake_timeout, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.yaw_current_clamp, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.kd_pt1_lowpass_frequency, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.kd_pt1_highpass_frequency, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.kd_biquad_lowpass, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.kd_biquad_highpass, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.booster_angle, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.booster_ramp, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.booster_current, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.torquetilt_start_current, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.torquetilt_angle_limit, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.torquetilt_on_speed, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.torquetilt_off_speed, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.torquetilt_strength, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.torquetilt_filter, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.turntilt_strength, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.turntilt_angle_limit, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.turntilt_start_angle, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.turntilt_start_erpm, &ind);
+	buffer_append_float32_auto(buffer, conf->app_balance_conf.turntilt_speed, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.turntilt_erpm_boost, &ind);
+	buffer_append_uint16(buffer, conf->app_balance_conf.turntilt_erpm_boost_end, &ind);
+	buffer[ind++] = conf->app_pas_conf.ctrl_type;
+	buffer[ind++] = conf->app_pas_conf.sensor_type;
+	buffer_append_float16(buffer, conf->app_pas_conf.current_scaling, 1000, &ind);
+	buffer_append_float16(buffer, conf->app_pas_conf.pedal_rpm_start, 10, &ind);
+	buffer_append_float16(buffer, conf->app_pas_conf.pedal_rpm_end, 10, &ind);
+	buffer[ind++] = conf->app_pas_conf.invert_pedal_direction;
+	buffer[ind++] = conf->app_pas_conf.magnets;
+	buffer[ind++] = conf->app_pas_conf.use_filter;
+	buffer_append_float16(buffer, conf->app_pas_conf.ramp_time_pos, 100, &ind);
+	buffer_append_float16(buffer, conf->app_pas_conf.ramp_time_neg, 100, &ind);
+	buffer_append_uint16(buffer, conf->app_pas_conf.update_rate_hz, &ind);
+	buffer[ind++] = conf->imu_conf.type;
+	buffer[ind++] = conf->imu_conf.mode;
+	buffer[ind++] = conf->imu_conf.filter;
+	buffer_append_uint16(buffer, conf->imu_conf.sample_rate_hz, &ind);
+	buffer[ind++] = conf->imu_conf.use_magnetometer;
+	buffer_append_float32_auto(buffer, conf->imu_conf.accel_confidence_decay, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.mahony_kp, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.mahony_ki, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.madgwick_beta, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.rot_roll, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.rot_pitch, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.rot_yaw, &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.accel_offsets[0], &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.accel_offsets[1], &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.accel_offsets[2], &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.gyro_offsets[0], &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.gyro_offsets[1], &ind);
+	buffer_append_float32_auto(buffer, conf->imu_conf.gyro_offsets[2], &ind);
+
+	return ind;
+}
+
+bool confgenerator_deserialize_mcconf(const uint8_t *buffer, int32_t len, mc_configuration *conf) {
+	int32_t ind = 0;
+
+	if (len != MCCONF_SERIALIZED_SIZE) {
+		return false;
+	}
+
+	uint32_t signature = buffer_get_uint32(buffer, &ind);
+	if (signature != MCCONF_SIGNATURE) {
+		return false;
+	}
+
+	conf->pwm_mode = (mc_pwm_mode)buffer[ind++];
+	conf->comm_mode = (mc_comm_mode)buffer[ind++];
+	conf->motor_type = (mc_motor_type)buffer[ind++];
+	conf->sensor_mode = (mc_sensor_mode)buffer[ind++];
+	conf->l_current_max = buffer_get_float32_auto(buffer, &ind);
+	conf->l_current_min = buffer_get_float32_auto(buffer, &ind);
+	conf->l_in_current_max = buffer_get_float32_auto(buffer, &ind);
+	conf->l_in_current_min = buffer_get_float32_auto(buffer, &ind);
+	conf->l_abs_current_max = buffer_get_float32_auto(buffer, &ind);
+	conf->l_min_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->l_max_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->l_erpm_start = buffer_get_float16(buffer, 10000, &ind);
+	conf->l_max_erpm_fbrake = buffer_get_float32_auto(buffer, &ind);
+	conf->l_max_erpm_fbrake_cc = buffer_get_float32_auto(buffer, &ind);
+	conf->l_min_vin = buffer_get_float32_auto(buffer, &ind);
+	conf->l_max_vin = buffer_get_float32_auto(buffer, &ind);
+	conf->l_battery_cut_start = buffer_get_float32_auto(buffer, &ind);
+	conf->l_battery_cut_end = buffer_get_float32_auto(buffer, &ind);
+	conf->l_slow_abs_current = buffer[ind++];
+	conf->l_temp_fet_start = buffer_get_float16(buffer, 10, &ind);
+	conf->l_temp_fet_end = buffer_get_float16(buffer, 10, &ind);
+	conf->l_temp_motor_start = buffer_get_float16(buffer, 10, &ind);
+	conf->l_temp_motor_end = buffer_get_float16(buffer, 10, &ind);
+	conf->l_temp_accel_dec = buffer_get_float16(buffer, 10000, &ind);
+	conf->l_min_duty = buffer_get_float16(buffer, 10000, &ind);
+	conf->l_max_duty = buffer_get_float16(buffer, 10000, &ind);
+	conf->l_watt_max = buffer_get_float32_auto(buffer, &ind);
+	conf->l_watt_min = buffer_get_float32_auto(buffer, &ind);
+	conf->l_current_max_scale = buffer_get_float16(buffer, 10000, &ind);
+	conf->l_current_min_scale = buffer_get_float16(buffer, 10000, &ind);
+	conf->l_duty_start = buffer_get_float16(buffer, 10000, &ind);
+	conf->sl_min_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->sl_min_erpm_cycle_int_limit = buffer_get_float32_auto(buffer, &ind);
+	conf->sl_max_fullbreak_current_dir_change = buffer_get_float32_auto(buffer, &ind);
+	conf->sl_cycle_int_limit = buffer_get_float16(buffer, 10, &ind);
+	conf->sl_phase_advance_at_br = buffer_get_float16(buffer, 10000, &ind);
+	conf->sl_cycle_int_rpm_br = buffer_get_float32_auto(buffer, &ind);
+	conf->sl_bemf_coupling_k = buffer_get_float32_auto(buffer, &ind);
+	conf->hall_table[0] = (int8_t)buffer[ind++];
+	conf->hall_table[1] = (int8_t)buffer[ind++];
+	conf->hall_table[2] = (int8_t)buffer[ind++];
+	conf->hall_table[3] = (int8_t)buffer[ind++];
+	conf->hall_table[4] = (int8_t)buffer[ind++];
+	conf->hall_table[5] = (int8_t)buffer[ind++];
+	conf->hall_table[6] = (int8_t)buffer[ind++];
+	conf->hall_table[7] = (int8_t)buffer[ind++];
+	conf->hall_sl_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_current_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_current_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_f_zv = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_dt_us = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_inverted = buffer[ind++];
+	conf->foc_encoder_offset = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_ratio = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_sin_gain = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_cos_gain = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_sin_offset = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_cos_offset = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_encoder_sincos_filter_constant = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_sensor_mode = (mc_foc_sensor_mode)buffer[ind++];
+	conf->foc_pll_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_pll_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_motor_l = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_motor_ld_lq_diff = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_motor_r = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_motor_flux_linkage = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_observer_gain = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_observer_gain_slow = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_observer_offset = buffer_get_float16(buffer, 1000, &ind);
+	conf->foc_duty_dowmramp_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_duty_dowmramp_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_openloop_rpm = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_openloop_rpm_low = buffer_get_float16(buffer, 1000, &ind);
+	conf->foc_d_gain_scale_start = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_d_gain_scale_max_mod = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_sl_openloop_hyst = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_sl_openloop_time_lock = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_sl_openloop_time_ramp = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_sl_openloop_time = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_sl_openloop_boost_q = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_sl_openloop_max_q = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_hall_table[0] = buffer[ind++];
+	conf->foc_hall_table[1] = buffer[ind++];
+	conf->foc_hall_table[2] = buffer[ind++];
+	conf->foc_hall_table[3] = buffer[ind++];
+	conf->foc_hall_table[4] = buffer[ind++];
+	conf->foc_hall_table[5] = buffer[ind++];
+	conf->foc_hall_table[6] = buffer[ind++];
+	conf->foc_hall_table[7] = buffer[ind++];
+	conf->foc_hall_interp_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_sl_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_sample_v0_v7 = buffer[ind++];
+	conf->foc_sample_high_current = buffer[ind++];
+	conf->foc_sat_comp = buffer_get_float16(buffer, 1000, &ind);
+	conf->foc_temp_comp = buffer[ind++];
+	conf->foc_temp_comp_base_temp = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_current_filter_const = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_cc_decoupling = (mc_foc_cc_decoupling_mode)buffer[ind++];
+	conf->foc_observer_type = (mc_foc_observer_type)buffer[ind++];
+	conf->foc_hfi_voltage_start = buffer_get_float16(buffer, 10, &ind);
+	conf->foc_hfi_voltage_run = buffer_get_float16(buffer, 10, &ind);
+	conf->foc_hfi_voltage_max = buffer_get_float16(buffer, 10, &ind);
+	conf->foc_hfi_gain = buffer_get_float16(buffer, 1000, &ind);
+	conf->foc_hfi_hyst = buffer_get_float16(buffer, 100, &ind);
+	conf->foc_sl_erpm_hfi = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_hfi_start_samples = buffer_get_uint16(buffer, &ind);
+	conf->foc_hfi_obs_ovr_sec = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_hfi_samples = (mc_foc_hfi_samples)buffer[ind++];
+	conf->foc_offsets_cal_on_boot = buffer[ind++];
+	conf->foc_offsets_current[0] = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_offsets_current[1] = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_offsets_current[2] = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_offsets_voltage[0] = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_offsets_voltage[1] = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_offsets_voltage[2] = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_offsets_voltage_undriven[0] = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_offsets_voltage_undriven[1] = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_offsets_voltage_undriven[2] = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_phase_filter_enable = buffer[ind++];
+	conf->foc_phase_filter_max_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_mtpa_mode = (MTPA_MODE)buffer[ind++];
+	conf->foc_fw_current_max = buffer_get_float32_auto(buffer, &ind);
+	conf->foc_fw_duty_start = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_fw_ramp_time = buffer_get_float16(buffer, 1000, &ind);
+	conf->foc_fw_q_current_factor = buffer_get_float16(buffer, 10000, &ind);
+	conf->foc_speed_soure = (SPEED_SRC)buffer[ind++];
+	conf->gpd_buffer_notify_left = buffer_get_int16(buffer, &ind);
+	conf->gpd_buffer_interpol = buffer_get_int16(buffer, &ind);
+	conf->gpd_current_filter_const = buffer_get_float16(buffer, 10000, &ind);
+	conf->gpd_current_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->gpd_current_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->sp_pid_loop_rate = (PID_RATE)buffer[ind++];
+	conf->s_pid_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->s_pid_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->s_pid_kd = buffer_get_float32_auto(buffer, &ind);
+	conf->s_pid_kd_filter = buffer_get_float16(buffer, 10000, &ind);
+	conf->s_pid_min_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->s_pid_allow_braking = buffer[ind++];
+	conf->s_pid_ramp_erpms_s = buffer_get_float32_auto(buffer, &ind);
+	conf->p_pid_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->p_pid_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->p_pid_kd = buffer_get_float32_auto(buffer, &ind);
+	conf->p_pid_kd_proc = buffer_get_float32_auto(buffer, &ind);
+	conf->p_pid_kd_filter = buffer_get_float16(buffer, 10000, &ind);
+	conf->p_pid_ang_div = buffer_get_float32_auto(buffer, &ind);
+	conf->p_pid_gain_dec_angle = buffer_get_float16(buffer, 10, &ind);
+	conf->p_pid_offset = buffer_get_float32_auto(buffer, &ind);
+	conf->cc_startup_boost_duty = buffer_get_float16(buffer, 10000, &ind);
+	conf->cc_min_current = buffer_get_float32_auto(buffer, &ind);
+	conf->cc_gain = buffer_get_float32_auto(buffer, &ind);
+	conf->cc_ramp_step_max = buffer_get_float16(buffer, 10000, &ind);
+	conf->m_fault_stop_time_ms = buffer_get_int32(buffer, &ind);
+	conf->m_duty_ramp_step = buffer_get_float16(buffer, 10000, &ind);
+	conf->m_current_backoff_gain = buffer_get_float32_auto(buffer, &ind);
+	conf->m_encoder_counts = buffer_get_uint32(buffer, &ind);
+	conf->m_sensor_port_mode = (sensor_port_mode)buffer[ind++];
+	conf->m_invert_direction = buffer[ind++];
+	conf->m_drv8301_oc_mode = (drv8301_oc_mode)buffer[ind++];
+	conf->m_drv8301_oc_adj = buffer[ind++];
+	conf->m_bldc_f_sw_min = buffer_get_float32_auto(buffer, &ind);
+	conf->m_bldc_f_sw_max = buffer_get_float32_auto(buffer, &ind);
+	conf->m_dc_f_sw = buffer_get_float32_auto(buffer, &ind);
+	conf->m_ntc_motor_beta = buffer_get_float32_auto(buffer, &ind);
+	conf->m_out_aux_mode = (out_aux_mode)buffer[ind++];
+	conf->m_motor_temp_sens_type = (temp_sensor_type)buffer[ind++];
+	conf->m_ptc_motor_coeff = buffer_get_float32_auto(buffer, &ind);
+	conf->m_hall_extra_samples = buffer[ind++];
+	conf->m_ntcx_ptcx_temp_base = buffer_get_float16(buffer, 10, &ind);
+	conf->m_ntcx_ptcx_res = buffer_get_float32_auto(buffer, &ind);
+	conf->si_motor_poles = buffer[ind++];
+	conf->si_gear_ratio = buffer_get_float32_auto(buffer, &ind);
+	conf->si_wheel_diameter = buffer_get_float32_auto(buffer, &ind);
+	conf->si_battery_type = (BATTERY_TYPE)buffer[ind++];
+	conf->si_battery_cells = buffer[ind++];
+	conf->si_battery_ah = buffer_get_float32_auto(buffer, &ind);
+	conf->si_motor_nl_current = buffer_get_float32_auto(buffer, &ind);
+	conf->bms.type = (BMS_TYPE)buffer[ind++];
+	conf->bms.t_limit_start = buffer_get_float16(buffer, 100, &ind);
+	conf->bms.t_limit_end = buffer_get_float16(buffer, 100, &ind);
+	conf->bms.soc_limit_start = buffer_get_float16(buffer, 1000, &ind);
+	conf->bms.soc_limit_end = buffer_get_float16(buffer, 1000, &ind);
+	conf->bms.fwd_can_mode = (BMS_FWD_CAN_MODE)buffer[ind++];
+
+	return true;
+}
+
+bool confgenerator_deserialize_appconf(const uint8_t *buffer, int32_t len, app_configuration *conf) {
+	int32_t ind = 0;
+
+	if (len != APPCONF_SERIALIZED_SIZE) {
+		return false;
+	}
+
+	uint32_t signature = buffer_get_uint32(buffer, &ind);
+	if (signature != APPCONF_SIGNATURE) {
+		return false;
+	}
+
+	conf->controller_id = buffer[ind++];
+	conf->timeout_msec = buffer_get_uint32(buffer, &ind);
+	conf->timeout_brake_current = buffer_get_float32_auto(buffer, &ind);
+	conf->can_status_rate_1 = buffer_get_uint16(buffer, &ind);
+	conf->can_status_msgs_r1 = buffer[ind++];
+	conf->can_status_rate_2 = buffer_get_uint16(buffer, &ind);
+	conf->can_status_msgs_r2 = buffer[ind++];
+	conf->can_baud_rate = (CAN_BAUD)buffer[ind++];
+	conf->pairing_done = buffer[ind++];
+	conf->permanent_uart_enabled = buffer[ind++];
+	conf->shutdown_mode = (SHUTDOWN_MODE)buffer[ind++];
+	conf->servo_out_enable = buffer[ind++];
+	conf->kill_sw_mode = (KILL_SW_MODE)buffer[ind++];
+	conf->can_mode = (CAN_MODE)buffer[ind++];
+	conf->uavcan_esc_index = buffer[ind++];
+	conf->uavcan_raw_mode = (UAVCAN_RAW_MODE)buffer[ind++];
+	conf->uavcan_raw_rpm_max = buffer_get_float32_auto(buffer, &ind);
+	conf->app_to_use = (app_use)buffer[ind++];
+	conf->app_ppm_conf.ctrl_type = (ppm_control_type)buffer[ind++];
+	conf->app_ppm_conf.pid_max_erpm = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.hyst = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.pulse_start = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.pulse_end = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.pulse_center = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.median_filter = buffer[ind++];
+	conf->app_ppm_conf.safe_start = (SAFE_START_MODE)buffer[ind++];
+	conf->app_ppm_conf.throttle_exp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.throttle_exp_brake = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.throttle_exp_mode = (thr_exp_mode)buffer[ind++];
+	conf->app_ppm_conf.ramp_time_pos = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.ramp_time_neg = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.multi_esc = buffer[ind++];
+	conf->app_ppm_conf.tc = buffer[ind++];
+	conf->app_ppm_conf.tc_max_diff = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.max_erpm_for_dir = buffer_get_float16(buffer, 1, &ind);
+	conf->app_ppm_conf.smart_rev_max_duty = buffer_get_float32_auto(buffer, &ind);
+	conf->app_ppm_conf.smart_rev_ramp_time = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.ctrl_type = (adc_control_type)buffer[ind++];
+	conf->app_adc_conf.hyst = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.voltage_start = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.voltage_end = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.voltage_min = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.voltage_max = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.voltage_center = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.voltage2_start = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.voltage2_end = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_adc_conf.use_filter = buffer[ind++];
+	conf->app_adc_conf.safe_start = (SAFE_START_MODE)buffer[ind++];
+	conf->app_adc_conf.cc_button_inverted = buffer[ind++];
+	conf->app_adc_conf.rev_button_inverted = buffer[ind++];
+	conf->app_adc_conf.voltage_inverted = buffer[ind++];
+	conf->app_adc_conf.voltage2_inverted = buffer[ind++];
+	conf->app_adc_conf.throttle_exp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.throttle_exp_brake = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.throttle_exp_mode = (thr_exp_mode)buffer[ind++];
+	conf->app_adc_conf.ramp_time_pos = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.ramp_time_neg = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.multi_esc = buffer[ind++];
+	conf->app_adc_conf.tc = buffer[ind++];
+	conf->app_adc_conf.tc_max_diff = buffer_get_float32_auto(buffer, &ind);
+	conf->app_adc_conf.update_rate_hz = buffer_get_uint16(buffer, &ind);
+	conf->app_uart_baudrate = buffer_get_uint32(buffer, &ind);
+	conf->app_chuk_conf.ctrl_type = (chuk_control_type)buffer[ind++];
+	conf->app_chuk_conf.hyst = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.ramp_time_pos = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.ramp_time_neg = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.stick_erpm_per_s_in_cc = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.throttle_exp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.throttle_exp_brake = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.throttle_exp_mode = (thr_exp_mode)buffer[ind++];
+	conf->app_chuk_conf.multi_esc = buffer[ind++];
+	conf->app_chuk_conf.tc = buffer[ind++];
+	conf->app_chuk_conf.tc_max_diff = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.use_smart_rev = buffer[ind++];
+	conf->app_chuk_conf.smart_rev_max_duty = buffer_get_float32_auto(buffer, &ind);
+	conf->app_chuk_conf.smart_rev_ramp_time = buffer_get_float32_auto(buffer, &ind);
+	conf->app_nrf_conf.speed = (NRF_SPEED)buffer[ind++];
+	conf->app_nrf_conf.power = (NRF_POWER)buffer[ind++];
+	conf->app_nrf_conf.crc_type = (NRF_CRC)buffer[ind++];
+	conf->app_nrf_conf.retry_delay = (NRF_RETR_DELAY)buffer[ind++];
+	conf->app_nrf_conf.retries = buffer[ind++];
+	conf->app_nrf_conf.channel = buffer[ind++];
+	conf->app_nrf_conf.address[0] = buffer[ind++];
+	conf->app_nrf_conf.address[1] = buffer[ind++];
+	conf->app_nrf_conf.address[2] = buffer[ind++];
+	conf->app_nrf_conf.send_crc_ack = buffer[ind++];
+	conf->app_balance_conf.kp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.ki = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.kd = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.hertz = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.loop_time_filter = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.fault_pitch = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.fault_roll = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.fault_duty = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.fault_adc1 = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.fault_adc2 = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.fault_delay_pitch = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.fault_delay_roll = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.fault_delay_duty = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.fault_delay_switch_half = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.fault_delay_switch_full = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.fault_adc_half_erpm = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.tiltback_duty_angle = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_duty_speed = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_duty = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_balance_conf.tiltback_hv_angle = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_hv_speed = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_hv = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.tiltback_lv_angle = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_lv_speed = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_lv = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.tiltback_return_speed = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.tiltback_constant = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.tiltback_constant_erpm = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.tiltback_variable = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.tiltback_variable_max = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.noseangling_speed = buffer_get_float16(buffer, 100, &ind);
+	conf->app_balance_conf.startup_pitch_tolerance = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.startup_roll_tolerance = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.startup_speed = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.deadzone = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.multi_esc = buffer[ind++];
+	conf->app_balance_conf.yaw_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.yaw_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.yaw_kd = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.roll_steer_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.roll_steer_erpm_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.brake_current = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.brake_timeout = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.yaw_current_clamp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.kd_pt1_lowpass_frequency = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.kd_pt1_highpass_frequency = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.kd_biquad_lowpass = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.kd_biquad_highpass = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.booster_angle = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.booster_ramp = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.booster_current = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.torquetilt_start_current = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.torquetilt_angle_limit = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.torquetilt_on_speed = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.torquetilt_off_speed = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.torquetilt_strength = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.torquetilt_filter = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.turntilt_strength = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.turntilt_angle_limit = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.turntilt_start_angle = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.turntilt_start_erpm = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.turntilt_speed = buffer_get_float32_auto(buffer, &ind);
+	conf->app_balance_conf.turntilt_erpm_boost = buffer_get_uint16(buffer, &ind);
+	conf->app_balance_conf.turntilt_erpm_boost_end = buffer_get_uint16(buffer, &ind);
+	conf->app_pas_conf.ctrl_type = (pas_control_type)buffer[ind++];
+	conf->app_pas_conf.sensor_type = (pas_sensor_type)buffer[ind++];
+	conf->app_pas_conf.current_scaling = buffer_get_float16(buffer, 1000, &ind);
+	conf->app_pas_conf.pedal_rpm_start = buffer_get_float16(buffer, 10, &ind);
+	conf->app_pas_conf.pedal_rpm_end = buffer_get_float16(buffer, 10, &ind);
+	conf->app_pas_conf.invert_pedal_direction = buffer[ind++];
+	conf->app_pas_conf.magnets = buffer[ind++];
+	conf->app_pas_conf.use_filter = buffer[ind++];
+	conf->app_pas_conf.ramp_time_pos = buffer_get_float16(buffer, 100, &ind);
+	conf->app_pas_conf.ramp_time_neg = buffer_get_float16(buffer, 100, &ind);
+	conf->app_pas_conf.update_rate_hz = buffer_get_uint16(buffer, &ind);
+	conf->imu_conf.type = (IMU_TYPE)buffer[ind++];
+	conf->imu_conf.mode = (AHRS_MODE)buffer[ind++];
+	conf->imu_conf.filter = (IMU_FILTER)buffer[ind++];
+	conf->imu_conf.sample_rate_hz = buffer_get_uint16(buffer, &ind);
+	conf->imu_conf.use_magnetometer = buffer[ind++];
+	conf->imu_conf.accel_confidence_decay = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.mahony_kp = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.mahony_ki = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.madgwick_beta = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.rot_roll = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.rot_pitch = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.rot_yaw = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.accel_offsets[0] = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.accel_offsets[1] = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.accel_offsets[2] = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.gyro_offsets[0] = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.gyro_offsets[1] = buffer_get_float32_auto(buffer, &ind);
+	conf->imu_conf.gyro_offsets[2] = buffer_get_float32_auto(buffer, &ind);
+
+	return true;
+}
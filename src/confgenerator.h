@@ -0,0 +1,23 @@
+#ifndef CONFGENERATOR_H_
+#define CONFGENERATOR_H_
+
+#include "datatypes.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Constants of the generated configuration layout of VESC firmware 6.00. Another firmware
+// reports a different signature; its configuration is rejected rather than misread, and
+// supporting it means regenerating the signatures, sizes and field lists together.
+#define MCCONF_SIGNATURE		3698540221
+#define APPCONF_SIGNATURE		2460147246
+
+#define MCCONF_SERIALIZED_SIZE		485
+#define APPCONF_SERIALIZED_SIZE		474
+
+// Functions
+int32_t confgenerator_serialize_mcconf(uint8_t *buffer, const mc_configuration *conf);
+int32_t confgenerator_serialize_appconf(uint8_t *buffer, const app_configuration *conf);
+bool confgenerator_deserialize_mcconf(const uint8_t *buffer, int32_t len, mc_configuration *conf);
+bool confgenerator_deserialize_appconf(const uint8_t *buffer, int32_t len, app_configuration *conf);
+
+#endif /* CONFGENERATOR_H_ */
@@ -57,4 +57,12 @@ unsigned short crc16(unsigned char *buf, unsigned int len) {
 		cksum = crc16_tab[(((cksum >> 8) ^ *buf++) & 0xFF)] ^ (cksum << 8);
 	}
 	return cksum;
-}
\ No newline at end of file
+}
+
+unsigned short crc16_continue(unsigned short cksum, unsigned char *buf, unsigned int len) {
+	unsigned int i;
+	for (i = 0; i < len; i++) {
+		cksum = crc16_tab[(((cksum >> 8) ^ *buf++) & 0xFF)] ^ (cksum << 8);
+	}
+	return cksum;
+}
@@ -0,0 +1,99 @@
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "Arduino.h"
+#include <stdio.h>
+#include <time.h>
+
+static uint64_t monotonic_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static const uint64_t startTime = monotonic_us();
+
+unsigned long millis(void) {
+	return (unsigned long)((monotonic_us() - startTime) / 1000);
+}
+
+unsigned long micros(void) {
+	return (unsigned long)(monotonic_us() - startTime);
+}
+
+void delay(unsigned long ms) {
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+size_t Print::write(const uint8_t * buffer, size_t size) {
+	size_t n = 0;
+	while (size--) {
+		n += write(*buffer++);
+	}
+	return n;
+}
+
+size_t Print::print(const char * str) {
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const String & str) {
+	return write((const uint8_t *)str.c_str(), str.length());
+}
+
+size_t Print::print(char c) {
+	return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value) {
+	return print((unsigned long)value);
+}
+
+size_t Print::print(int value) {
+	return print((long)value);
+}
+
+size_t Print::print(unsigned int value) {
+	return print((unsigned long)value);
+}
+
+size_t Print::print(long value) {
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), "%ld", value);
+	return print(buffer);
+}
+
+size_t Print::print(unsigned long value) {
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), "%lu", value);
+	return print(buffer);
+}
+
+size_t Print::print(double value) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.2f", value);
+	return print(buffer);
+}
+
+size_t Print::println(void) {
+	return print("\r\n");
+}
+
+size_t Stream::readBytes(uint8_t * buffer, size_t length) {
+	size_t count = 0;
+	unsigned long start = millis();
+
+	while (count < length && millis() - start < timeout) {
+		int c = read();
+		if (c < 0) {
+			continue;
+		}
+		buffer[count++] = (uint8_t)c;
+		start = millis();
+	}
+	return count;
+}
+
+#endif
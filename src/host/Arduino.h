@@ -0,0 +1,81 @@
+/*
+	Minimal Arduino API for building VescUart on Linux. Only what the library uses is
+	provided: Print, Stream, String, millis(), micros() and delay(). Add src/host to the
+	include path of a host build; Arduino builds never see this header.
+*/
+
+#ifndef _VESCUART_HOST_ARDUINO_h
+#define _VESCUART_HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+class String : public std::string
+{
+	public:
+		String(const char * str = "") : std::string(str) {}
+		String(const std::string & str) : std::string(str) {}
+		String(char c) : std::string(1, c) {}
+		String(unsigned char value) : std::string(std::to_string(value)) {}
+		String(int value) : std::string(std::to_string(value)) {}
+		String(unsigned int value) : std::string(std::to_string(value)) {}
+		String(long value) : std::string(std::to_string(value)) {}
+		String(unsigned long value) : std::string(std::to_string(value)) {}
+		String(double value) : std::string(std::to_string(value)) {}
+};
+
+inline String operator+(const String & a, const String & b) {
+	return String(static_cast<const std::string &>(a) + static_cast<const std::string &>(b));
+}
+
+inline String operator+(const char * a, const String & b) {
+	return String(a + static_cast<const std::string &>(b));
+}
+
+class Print
+{
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t byte) = 0;
+		virtual size_t write(const uint8_t * buffer, size_t size);
+
+		size_t print(const char * str);
+		size_t print(const String & str);
+		size_t print(char c);
+		size_t print(unsigned char value);
+		size_t print(int value);
+		size_t print(unsigned int value);
+		size_t print(long value);
+		size_t print(unsigned long value);
+		size_t print(double value);
+
+		size_t println(void);
+		template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+};
+
+class Stream : public Print
+{
+	public:
+		virtual int available(void) = 0;
+		virtual int read(void) = 0;
+		virtual int peek(void) = 0;
+		virtual void flush(void) {}
+
+		void setTimeout(unsigned long timeout_ms) { timeout = timeout_ms; }
+
+		/** Reads up to length bytes, waiting up to the timeout for each */
+		size_t readBytes(uint8_t * buffer, size_t length);
+		size_t readBytes(char * buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+
+	protected:
+		unsigned long timeout = 1000;
+};
+
+#endif
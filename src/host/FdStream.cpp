@@ -0,0 +1,148 @@
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "FdStream.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+FdStream::FdStream(int fd) : descriptor(fd) {
+	int flags = fcntl(fd, F_GETFL);
+	if (flags >= 0) {
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	}
+}
+
+int FdStream::openSerial(const char * path, unsigned long baud) {
+
+	speed_t speed;
+	switch (baud) {
+		case 9600:    speed = B9600;    break;
+		case 19200:   speed = B19200;   break;
+		case 38400:   speed = B38400;   break;
+		case 57600:   speed = B57600;   break;
+		case 115200:  speed = B115200;  break;
+		case 230400:  speed = B230400;  break;
+		case 460800:  speed = B460800;  break;
+		case 921600:  speed = B921600;  break;
+		default:
+			return -1;
+	}
+
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct termios tty;
+	if (tcgetattr(fd, &tty) != 0) {
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tty);
+	cfsetispeed(&tty, speed);
+	cfsetospeed(&tty, speed);
+	tty.c_cflag |= CLOCAL | CREAD;
+	tty.c_cc[VMIN] = 0;
+	tty.c_cc[VTIME] = 0;
+	if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int FdStream::available(void) {
+	return rxTail - rxHead;
+}
+
+int FdStream::read(void) {
+	if (rxHead == rxTail) {
+		return -1;
+	}
+	return rxBuffer[rxHead++];
+}
+
+int FdStream::peek(void) {
+	if (rxHead == rxTail) {
+		return -1;
+	}
+	return rxBuffer[rxHead];
+}
+
+size_t FdStream::write(uint8_t byte) {
+	return write(&byte, 1);
+}
+
+size_t FdStream::write(const uint8_t * buffer, size_t size) {
+
+	size_t written = 0;
+
+	// Keep the byte order: only write directly when nothing is queued
+	if (txCount == 0) {
+		ssize_t n = ::write(descriptor, buffer, size);
+		if (n > 0) {
+			written = n;
+		}
+	}
+
+	while (written < size) {
+		if (txCount == FDSTREAM_TX_BUFFER_SIZE) {
+			txDropped += size - written;
+			break;
+		}
+		txBuffer[(txHead + txCount) % FDSTREAM_TX_BUFFER_SIZE] = buffer[written++];
+		txCount++;
+	}
+	return written;
+}
+
+int FdStream::readFromFd(void) {
+
+	// The parser drains the buffer on every update(), so start over when it is empty
+	if (rxHead == rxTail) {
+		rxHead = rxTail = 0;
+	} else if (rxTail == FDSTREAM_RX_BUFFER_SIZE) {
+		memmove(rxBuffer, rxBuffer + rxHead, rxTail - rxHead);
+		rxTail -= rxHead;
+		rxHead = 0;
+	}
+	if (rxTail == FDSTREAM_RX_BUFFER_SIZE) {
+		return 0; // Full, update() has to consume first
+	}
+
+	ssize_t n = ::read(descriptor, rxBuffer + rxTail, FDSTREAM_RX_BUFFER_SIZE - rxTail);
+	if (n > 0) {
+		rxTail += n;
+		return n;
+	}
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+		return 0;
+	}
+	return -1;
+}
+
+int FdStream::flushToFd(void) {
+
+	while (txCount > 0) {
+		int chunk = FDSTREAM_TX_BUFFER_SIZE - txHead;
+		if (chunk > txCount) {
+			chunk = txCount;
+		}
+		ssize_t n = ::write(descriptor, txBuffer + txHead, chunk);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				break;
+			}
+			return -1;
+		}
+		txHead = (txHead + n) % FDSTREAM_TX_BUFFER_SIZE;
+		txCount -= n;
+	}
+	if (txCount == 0) {
+		txHead = 0;
+	}
+	return txCount;
+}
+
+#endif
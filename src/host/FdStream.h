@@ -0,0 +1,84 @@
+/*
+	Stream over a non-blocking file descriptor (serial port, pty or socket) for the
+	Linux host build. Bytes are only moved between the fd and the buffers by
+	readFromFd() and flushToFd(), so VescUart never blocks on the descriptor.
+*/
+
+#ifndef _FDSTREAM_h
+#define _FDSTREAM_h
+
+#include <Arduino.h>
+
+/** Size of the receive buffer, the most that one readFromFd() takes from the fd */
+#ifndef FDSTREAM_RX_BUFFER_SIZE
+#define FDSTREAM_RX_BUFFER_SIZE 4096
+#endif
+
+/** Size of the transmit queue for bytes the fd did not accept immediately */
+#ifndef FDSTREAM_TX_BUFFER_SIZE
+#define FDSTREAM_TX_BUFFER_SIZE 4096
+#endif
+
+class FdStream : public Stream
+{
+	public:
+
+		/**
+		 * @brief      Wraps an open descriptor and makes it non-blocking. The descriptor is not closed.
+		 * @param      fd  - The file descriptor
+		 */
+		FdStream(int fd);
+
+		/**
+		 * @brief      Opens a serial port in raw mode, e.g. /dev/ttyUSB0
+		 * @param      path  - Path of the tty device
+		 * @param      baud  - Baud rate
+		 * @return     The descriptor, or -1 on error
+		 */
+		static int openSerial(const char * path, unsigned long baud);
+
+		int available(void) override;
+		int read(void) override;
+		int peek(void) override;
+		size_t write(uint8_t byte) override;
+
+		/**
+		 * @brief      Writes to the fd, or queues what it does not accept
+		 * @return     Number of bytes written or queued, less than size if the transmit queue is full
+		 */
+		size_t write(const uint8_t * buffer, size_t size) override;
+
+		/**
+		 * @brief      Reads whatever the fd has into the receive buffer
+		 * @return     Number of bytes read, 0 if nothing was available, -1 on error or hang-up
+		 */
+		int readFromFd(void);
+
+		/**
+		 * @brief      Writes as much of the transmit queue as the fd accepts
+		 * @return     Number of bytes still queued, -1 on error
+		 */
+		int flushToFd(void);
+
+		/** @return Number of bytes waiting in the transmit queue */
+		int pending(void) { return txCount; }
+
+		int fd(void) { return descriptor; }
+
+		/** Number of bytes dropped because the transmit queue was full */
+		uint32_t txDropped = 0;
+
+	private:
+
+		int descriptor;
+
+		uint8_t rxBuffer[FDSTREAM_RX_BUFFER_SIZE];
+		int rxHead = 0;
+		int rxTail = 0;
+
+		uint8_t txBuffer[FDSTREAM_TX_BUFFER_SIZE];
+		int txHead = 0;
+		int txCount = 0;
+};
+
+#endif
@@ -0,0 +1,395 @@
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "VescAsync.h"
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+VescAsync::VescAsync(VescEventLoop & loop, VescUart & vesc, FdStream & stream) : loop(loop), vesc(vesc) {
+
+	for (int i = 0; i < VESCASYNC_MAX_IN_FLIGHT; i++) {
+		requests[i].used = false;
+	}
+	timeout_ms = vesc._TIMEOUT;
+
+	loop.addLink(vesc, stream, 0, NULL, handleUpdate, this);
+	vesc.setPacketHandler(COMM_GET_VALUES, handleReply, this);
+	vesc.setPacketHandler(COMM_FW_VERSION, handleReply, this);
+}
+
+VescAsync::~VescAsync(void) {
+	vesc.setPacketHandler(COMM_GET_VALUES, NULL, NULL);
+	vesc.setPacketHandler(COMM_FW_VERSION, NULL, NULL);
+	loop.removeLink(vesc);
+}
+
+void VescAsync::setTimeout(uint32_t timeout_ms) {
+	this->timeout_ms = timeout_ms;
+}
+
+template <typename T>
+VescAsync::reply<T> VescAsync::makeReply(COMM_PACKET_ID packetId, uint8_t canId) {
+	reply<T> r;
+	r.async = this;
+	r.packetId = packetId;
+	r.canId = canId;
+	return r;
+}
+
+VescAsync::reply<VescUart::dataPackage> VescAsync::getValues(void) {
+	return getValues(0);
+}
+
+VescAsync::reply<VescUart::dataPackage> VescAsync::getValues(uint8_t canId) {
+	return makeReply<VescUart::dataPackage>(COMM_GET_VALUES, canId);
+}
+
+VescAsync::reply<VescUart::FWversionPackage> VescAsync::getFWversion(void) {
+	return getFWversion(0);
+}
+
+VescAsync::reply<VescUart::FWversionPackage> VescAsync::getFWversion(uint8_t canId) {
+	return makeReply<VescUart::FWversionPackage>(COMM_FW_VERSION, canId);
+}
+
+std::suspend_never VescAsync::setCurrent(float current) {
+	return setCurrent(current, 0);
+}
+
+std::suspend_never VescAsync::setCurrent(float current, uint8_t canId) {
+	vesc.setCurrent(current, canId);
+	return {};
+}
+
+std::suspend_never VescAsync::setBrakeCurrent(float brakeCurrent) {
+	return setBrakeCurrent(brakeCurrent, 0);
+}
+
+std::suspend_never VescAsync::setBrakeCurrent(float brakeCurrent, uint8_t canId) {
+	vesc.setBrakeCurrent(brakeCurrent, canId);
+	return {};
+}
+
+std::suspend_never VescAsync::setRPM(float rpm) {
+	return setRPM(rpm, 0);
+}
+
+std::suspend_never VescAsync::setRPM(float rpm, uint8_t canId) {
+	vesc.setRPM(rpm, canId);
+	return {};
+}
+
+std::suspend_never VescAsync::setDuty(float duty) {
+	return setDuty(duty, 0);
+}
+
+std::suspend_never VescAsync::setDuty(float duty, uint8_t canId) {
+	vesc.setDuty(duty, canId);
+	return {};
+}
+
+void VescAsync::submit(waiter * w) {
+
+	w->deadline = millis() + timeout_ms;
+	w->value = NULL;
+	w->next = NULL;
+
+	if (!attach(w)) {
+		if (queuedTail != NULL) {
+			queuedTail->next = w;
+		} else {
+			queuedHead = w;
+		}
+		queuedTail = w;
+	}
+	schedule(w->deadline);
+}
+
+bool VescAsync::attach(waiter * w) {
+
+	// Share the reply of a request that is already on the wire, else send one
+	request * r = find(w->packetId, w->canId);
+	if (r == NULL) {
+		r = send(w->packetId, w->canId, w->deadline);
+		if (r == NULL) {
+			return false;
+		}
+	}
+
+	w->next = NULL;
+	if (r->tail != NULL) {
+		r->tail->next = w;
+	} else {
+		r->head = w;
+	}
+	r->tail = w;
+	if ((int32_t)(w->deadline - r->expires) > 0) {
+		r->expires = w->deadline;
+	}
+	return true;
+}
+
+VescAsync::request * VescAsync::find(uint8_t packetId, uint8_t canId) {
+	for (int i = 0; i < VESCASYNC_MAX_IN_FLIGHT; i++) {
+		if (requests[i].used && requests[i].packetId == packetId && requests[i].canId == canId) {
+			return &requests[i];
+		}
+	}
+	return NULL;
+}
+
+bool VescAsync::attributable(uint8_t packetId, uint8_t canId) {
+	// Only the values reply of firmware 3 and newer tells which controller sent it
+	if (packetId != COMM_GET_VALUES) {
+		return false;
+	}
+	VescUart::valuesLayout layout = vesc.getValuesLayout(canId);
+	return layout == VescUart::VALUES_LAYOUT_FW3 || layout == VescUart::VALUES_LAYOUT_FW5;
+}
+
+VescAsync::request * VescAsync::send(uint8_t packetId, uint8_t canId, uint32_t expires) {
+
+	// The values layout depends on the firmware, so its version goes out first. The values
+	// request waits until it is known, then it can be told apart from those of other controllers.
+	// If the controller did not answer, or the cache had no room for it, the values go out on
+	// their own, as their reply cannot be attributed.
+	if (packetId == COMM_GET_VALUES && vesc.getValuesLayout(canId) == VescUart::VALUES_LAYOUT_UNKNOWN
+		&& !(fwAsked[canId / 8] & (1 << (canId % 8)))) {
+		if (find(COMM_FW_VERSION, canId) == NULL) {
+			send(COMM_FW_VERSION, canId, expires);
+		}
+		return NULL;
+	}
+
+	// A reply that does not say who sent it can only be matched if it is the only one expected
+	request * r = NULL;
+	bool exclusive = !attributable(packetId, canId);
+	for (int i = 0; i < VESCASYNC_MAX_IN_FLIGHT; i++) {
+		if (!requests[i].used) {
+			if (r == NULL) {
+				r = &requests[i];
+			}
+		} else if (exclusive && requests[i].packetId == packetId && !attributable(packetId, requests[i].canId)) {
+			return NULL;
+		}
+	}
+	if (r == NULL) {
+		return NULL;
+	}
+
+	r->used = true;
+	r->packetId = packetId;
+	r->canId = canId;
+	r->seq = nextSeq++;
+	r->expires = expires;
+	r->sent_us = micros();
+	r->head = NULL;
+	r->tail = NULL;
+
+	uint8_t payload[1] = { packetId };
+	vesc.packSendPayload(payload, 1, canId);
+	schedule(expires);
+	return r;
+}
+
+VescAsync::request * VescAsync::match(uint8_t packetId, int len) {
+
+	// The controller id in a values reply, found and attributed as by VescUart itself. The
+	// reply is still in rxBuffer, with the packet id in front of the len bytes of the handler.
+	int index = packetId == COMM_GET_VALUES ? vesc.replyIdIndex(vesc.rxBuffer, len + 1) : -1;
+	int sender = index >= 0 ? vesc.rxBuffer[index] : -1;
+
+	request * best = NULL;
+	for (int i = 0; i < VESCASYNC_MAX_IN_FLIGHT; i++) {
+		request * r = &requests[i];
+		if (!r->used || r->packetId != packetId) {
+			continue;
+		}
+		if (sender >= 0 && attributable(packetId, r->canId)) {
+			// The id of the local controller is not known, but it is none of the CAN ids in use
+			if (r->canId != 0 ? r->canId != sender : vesc.isCanController(sender)) {
+				continue;
+			}
+		}
+		if (best == NULL || (int32_t)(r->seq - best->seq) < 0) {
+			best = r;
+		}
+	}
+	return best;
+}
+
+void VescAsync::complete(request * r, const void * value) {
+
+	waiter * w = r->head;
+	r->used = false;
+	drainQueued();
+
+	// A resumed coroutine may co_await again and free its frame, so take next first
+	while (w != NULL) {
+		waiter * next = w->next;
+		w->value = value;
+		w->handle.resume();
+		w = next;
+	}
+}
+
+void VescAsync::drainQueued(void) {
+
+	waiter * prev = NULL;
+	waiter * w = queuedHead;
+
+	while (w != NULL) {
+		waiter * next = w->next;
+		if (attach(w)) {
+			if (prev != NULL) {
+				prev->next = next;
+			} else {
+				queuedHead = next;
+			}
+			if (queuedTail == w) {
+				queuedTail = prev;
+			}
+		} else {
+			prev = w;
+		}
+		w = next;
+	}
+}
+
+void VescAsync::expire(void) {
+
+	uint32_t now = millis();
+	waiter * expired = NULL;
+
+	// Unlink every waiter past its deadline, then resume them once the lists are consistent
+	for (int i = 0; i < VESCASYNC_MAX_IN_FLIGHT; i++) {
+		request * r = &requests[i];
+		if (!r->used) {
+			continue;
+		}
+		waiter * prev = NULL;
+		waiter * w = r->head;
+		while (w != NULL) {
+			waiter * next = w->next;
+			if ((int32_t)(now - w->deadline) >= 0) {
+				if (prev != NULL) {
+					prev->next = next;
+				} else {
+					r->head = next;
+				}
+				if (r->tail == w) {
+					r->tail = prev;
+				}
+				w->next = expired;
+				expired = w;
+			} else {
+				prev = w;
+			}
+			w = next;
+		}
+		if ((int32_t)(now - r->expires) >= 0) {
+			r->used = false;
+			if (r->packetId == COMM_FW_VERSION) {
+				// Remember the silence like VescUart::queryFWversionOnce(), so it is not asked again
+				vesc.findFWcacheEntry(r->canId, true);
+				fwAsked[r->canId / 8] |= 1 << (r->canId % 8);
+			}
+		}
+	}
+
+	waiter * prev = NULL;
+	waiter * w = queuedHead;
+	while (w != NULL) {
+		waiter * next = w->next;
+		if ((int32_t)(now - w->deadline) >= 0) {
+			if (prev != NULL) {
+				prev->next = next;
+			} else {
+				queuedHead = next;
+			}
+			if (queuedTail == w) {
+				queuedTail = prev;
+			}
+			w->next = expired;
+			expired = w;
+		} else {
+			prev = w;
+		}
+		w = next;
+	}
+
+	drainQueued();
+
+	// Wake up again for the earliest deadline left
+	wakeSet = false;
+	for (int i = 0; i < VESCASYNC_MAX_IN_FLIGHT; i++) {
+		if (requests[i].used) {
+			schedule(requests[i].expires);
+			for (waiter * w = requests[i].head; w != NULL; w = w->next) {
+				schedule(w->deadline);
+			}
+		}
+	}
+	for (waiter * w = queuedHead; w != NULL; w = w->next) {
+		schedule(w->deadline);
+	}
+
+	while (expired != NULL) {
+		waiter * next = expired->next;
+		timeouts++;
+		expired->value = NULL;
+		expired->handle.resume();
+		expired = next;
+	}
+}
+
+void VescAsync::schedule(uint32_t at) {
+	if (!wakeSet || (int32_t)(at - wakeTime) < 0) {
+		wakeSet = true;
+		wakeTime = at;
+		loop.wakeAt(vesc, at);
+	}
+}
+
+bool VescAsync::handleReply(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t, void * context) {
+
+	VescAsync * async = (VescAsync *)context;
+	VescUart & vesc = async->vesc;
+
+	request * r = async->match(packetId, len);
+	if (r == NULL) {
+		return false; // Nobody asked, or it already timed out
+	}
+
+	if (packetId == COMM_FW_VERSION) {
+		if (!vesc.decodeFWversion(data, len, r->canId)) {
+			return false;
+		}
+		async->fwAsked[r->canId / 8] |= 1 << (r->canId % 8);
+		VescUart::FWversionPackage value = vesc.fw_version;
+		async->complete(r, &value);
+		return true;
+	}
+
+	if (!vesc.decodeValues(data, len, vesc.getValuesLayout(r->canId))) {
+		return false;
+	}
+	vesc.dataRaw.rxTime_us = vesc.rxStart_us;
+	vesc.dataRaw.txTime_us = r->sent_us;
+	vesc.convertRawValues();
+	VescUart::dataPackage value = vesc.data;
+	async->complete(r, &value);
+	return true;
+}
+
+void VescAsync::handleUpdate(VescUart &, void * context) {
+
+	// Also called for every decoded packet, so only look at the deadlines when one is due
+	VescAsync * async = (VescAsync *)context;
+	if (async->wakeSet && (int32_t)(millis() - async->wakeTime) >= 0) {
+		async->expire();
+	}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+/*
+	C++20 coroutine interface for the Linux host build, on top of VescEventLoop:
+
+		VescTask log(VescAsync & vesc) {
+			auto values = co_await vesc.getValues(1);
+			if (values) { ... }
+			co_await vesc.setCurrent(2.0, 1);
+		}
+
+	Requests are sent at once instead of one after the other, up to VESCASYNC_MAX_IN_FLIGHT
+	distinct requests per link. Coroutines that ask for the same thing while a request is in
+	flight share its reply, so thousands of them cost no more than the requests on the wire.
+	Values replies carry the controller id, so requests to several controllers are matched by
+	it. For other replies only one request of their kind is in flight at a time.
+*/
+
+#ifndef _VESCASYNC_h
+#define _VESCASYNC_h
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include "VescEventLoop.h"
+
+/** Maximum number of distinct requests in flight on one link; more wait for a free slot */
+#ifndef VESCASYNC_MAX_IN_FLIGHT
+#define VESCASYNC_MAX_IN_FLIGHT 16
+#endif
+
+/** Return type of a coroutine that starts when called and frees itself when it returns */
+struct VescTask
+{
+	struct promise_type {
+		VescTask get_return_object(void) { return VescTask(); }
+		std::suspend_never initial_suspend(void) noexcept { return {}; }
+		std::suspend_never final_suspend(void) noexcept { return {}; }
+		void return_void(void) {}
+		void unhandled_exception(void) { std::terminate(); }
+	};
+};
+
+class VescAsync
+{
+	public:
+
+		/** State of one co_await, kept in the frame of the awaiting coroutine */
+		struct waiter {
+			VescAsync * async;
+			uint8_t packetId;
+			uint8_t canId;
+			uint32_t deadline;
+			std::coroutine_handle<> handle;
+			const void * value;	// The decoded reply, NULL on timeout
+			waiter * next;
+
+			bool await_ready(void) { return false; }
+			void await_suspend(std::coroutine_handle<> h) { handle = h; async->submit(this); }
+		};
+
+		/** Awaitable reply, empty if the request timed out */
+		template <typename T>
+		struct reply : waiter {
+			std::optional<T> await_resume(void) {
+				if (value == NULL) {
+					return std::nullopt;
+				}
+				return *(const T *)value;
+			}
+		};
+
+		/**
+		 * @brief      Adds the link to the loop. Do not call the blocking getters of vesc while it is
+		 *             in use here, as they take over its packet handlers.
+		 * @param      loop   - The event loop that drives the link
+		 * @param      vesc   - The VescUart of the link
+		 * @param      stream - The stream of the link
+		 */
+		VescAsync(VescEventLoop & loop, VescUart & vesc, FdStream & stream);
+
+		/** Removes the link from the loop. Coroutines still waiting on it are never resumed. */
+		~VescAsync(void);
+
+		/**
+		 * @brief      Sets the time after which a co_await gives up, by default the timeout of the VescUart
+		 * @param      timeout_ms - The timeout in milliseconds
+		 */
+		void setTimeout(uint32_t timeout_ms);
+
+		/**
+		 * @brief      Requests the telemetry values, like getVescValues()
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     Awaitable for the values, empty on timeout
+		 */
+		reply<VescUart::dataPackage> getValues(void);
+		reply<VescUart::dataPackage> getValues(uint8_t canId);
+
+		/**
+		 * @brief      Requests the firmware version, like getFWversion()
+		 * @param      canId  - The CAN ID of the VESC
+		 * @return     Awaitable for the version, empty on timeout
+		 */
+		reply<VescUart::FWversionPackage> getFWversion(void);
+		reply<VescUart::FWversionPackage> getFWversion(uint8_t canId);
+
+		/**
+		 * @brief      Set commands. The VESC does not reply to them, so awaiting them completes at once.
+		 * @param      canId  - The CAN ID of the VESC
+		 */
+		std::suspend_never setCurrent(float current);
+		std::suspend_never setCurrent(float current, uint8_t canId);
+		std::suspend_never setBrakeCurrent(float brakeCurrent);
+		std::suspend_never setBrakeCurrent(float brakeCurrent, uint8_t canId);
+		std::suspend_never setRPM(float rpm);
+		std::suspend_never setRPM(float rpm, uint8_t canId);
+		std::suspend_never setDuty(float duty);
+		std::suspend_never setDuty(float duty, uint8_t canId);
+
+		/** Number of co_awaits that timed out */
+		uint32_t timeouts = 0;
+
+	private:
+
+		/** A request on the wire and the coroutines waiting for its reply */
+		struct request {
+			bool used;
+			uint8_t packetId;
+			uint8_t canId;
+			uint32_t seq;		// Send order, replies arrive in it
+			uint32_t expires;	// Latest deadline of the waiters, a late reply is still consumed until then
+			uint32_t sent_us;	// micros() when it was sent
+			waiter * head;
+			waiter * tail;
+		};
+
+		VescEventLoop & loop;
+		VescUart & vesc;
+
+		request requests[VESCASYNC_MAX_IN_FLIGHT];
+		uint32_t nextSeq = 0;
+		uint32_t timeout_ms;
+
+		/** Waiters for which no request slot was free */
+		waiter * queuedHead = NULL;
+		waiter * queuedTail = NULL;
+
+		/** Bit per CAN ID: its firmware version was asked for and answered or timed out */
+		uint8_t fwAsked[32] = {};
+
+		bool wakeSet = false;
+		uint32_t wakeTime;
+
+		template <typename T>
+		reply<T> makeReply(COMM_PACKET_ID packetId, uint8_t canId);
+
+		void submit(waiter * w);
+		bool attach(waiter * w);
+		request * find(uint8_t packetId, uint8_t canId);
+		bool attributable(uint8_t packetId, uint8_t canId);
+		request * send(uint8_t packetId, uint8_t canId, uint32_t expires);
+		request * match(uint8_t packetId, int len);
+		void complete(request * r, const void * value);
+		void drainQueued(void);
+		void expire(void);
+		void schedule(uint32_t at);
+
+		static bool handleReply(COMM_PACKET_ID packetId, uint8_t * data, int len, uint8_t canId, void * context);
+		static void handleUpdate(VescUart & vesc, void * context);
+};
+
+#endif
+
+#endif
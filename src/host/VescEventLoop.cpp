@@ -0,0 +1,216 @@
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "VescEventLoop.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+VescEventLoop::VescEventLoop(void) {
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+}
+
+VescEventLoop::~VescEventLoop(void) {
+	if (epollFd >= 0) {
+		close(epollFd);
+	}
+}
+
+bool VescEventLoop::addLink(VescUart & vesc, FdStream & stream, uint32_t period_ms, linkCallback onPoll, linkCallback onUpdate, void * context) {
+
+	if (epollFd < 0 || count == VESCEVENTLOOP_MAX_LINKS) {
+		return false;
+	}
+
+	// The event carries the VescUart, as the slot of a link moves when another is removed
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = &vesc;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, stream.fd(), &event) != 0) {
+		return false;
+	}
+
+	link * l = &links[count++];
+	l->vesc = &vesc;
+	l->stream = &stream;
+	l->period_ms = period_ms;
+	l->nextPoll = millis();
+	l->onPoll = onPoll;
+	l->onUpdate = onUpdate;
+	l->context = context;
+	l->writing = false;
+	l->waking = false;
+
+	vesc.setSerialPort(&stream);
+	return true;
+}
+
+bool VescEventLoop::removeLink(VescUart & vesc) {
+	for (int i = 0; i < count; i++) {
+		if (links[i].vesc == &vesc) {
+			remove(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void VescEventLoop::remove(int i) {
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, links[i].stream->fd(), NULL);
+	links[i] = links[--count];
+}
+
+void VescEventLoop::wakeAt(VescUart & vesc, uint32_t at_ms) {
+	for (int i = 0; i < count; i++) {
+		if (links[i].vesc == &vesc) {
+			links[i].waking = true;
+			links[i].wakeTime = at_ms;
+		}
+	}
+}
+
+int VescEventLoop::linkCount(void) {
+	return count;
+}
+
+int VescEventLoop::runOnce(int timeout_ms) {
+
+	// Sleep until the nearest deadline at most
+	uint32_t now = millis();
+	for (int i = 0; i < count; i++) {
+		uint32_t next = nearestDeadline(&links[i], now);
+		if (next == UINT32_MAX) {
+			continue;
+		}
+		if (timeout_ms < 0 || next < (uint32_t)timeout_ms) {
+			timeout_ms = next;
+		}
+	}
+
+	struct epoll_event events[VESCEVENTLOOP_MAX_LINKS];
+	int n = epoll_wait(epollFd, events, VESCEVENTLOOP_MAX_LINKS, timeout_ms);
+	if (n < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+
+	int packets = 0;
+
+	for (int e = 0; e < n; e++) {
+		VescUart * vesc = (VescUart *)events[e].data.ptr;
+		int i = 0;
+		while (i < count && links[i].vesc != vesc) {
+			i++;
+		}
+		if (i == count) {
+			continue; // Removed by a callback of an earlier event
+		}
+		link * l = &links[i];
+
+		if (events[e].events & EPOLLOUT) {
+			if (l->stream->flushToFd() < 0) {
+				linkErrors++;
+				remove(i);
+				continue;
+			}
+		}
+
+		if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+			// Drain the fd, the stream holds at most one buffer full per read
+			int read;
+			while ((read = l->stream->readFromFd()) > 0) {
+				int decoded = l->vesc->update();
+				packets += decoded;
+				if (decoded > 0 && l->onUpdate != NULL) {
+					l->onUpdate(*l->vesc, l->context);
+				}
+			}
+			if (read < 0) {
+				linkErrors++;
+				remove(i);
+				continue;
+			}
+		}
+
+		watchWritable(l);
+	}
+
+	now = millis();
+	for (int i = 0; i < count; i++) {
+		link * l = &links[i];
+		if (l->waking && (int32_t)(now - l->wakeTime) >= 0) {
+			l->waking = false;
+			if (l->onUpdate != NULL) {
+				l->onUpdate(*l->vesc, l->context);
+			}
+			watchWritable(l);
+		}
+		if (l->period_ms == 0 || (int32_t)(now - l->nextPoll) < 0) {
+			continue;
+		}
+		// Keep the phase, but do not catch up on polls missed while the loop was busy
+		l->nextPoll += l->period_ms;
+		if ((int32_t)(now - l->nextPoll) >= 0) {
+			l->nextPoll = now + l->period_ms;
+		}
+		poll(l);
+		watchWritable(l);
+	}
+
+	return packets;
+}
+
+void VescEventLoop::run(void) {
+	running = true;
+	while (running) {
+		if (runOnce(-1) < 0) {
+			break;
+		}
+	}
+}
+
+void VescEventLoop::stop(void) {
+	running = false;
+}
+
+uint32_t VescEventLoop::nearestDeadline(link * l, uint32_t now) {
+
+	// Milliseconds until the next poll or wake-up of the link, UINT32_MAX if there is none
+	uint32_t next = UINT32_MAX;
+	if (l->period_ms != 0) {
+		int32_t due = (int32_t)(l->nextPoll - now);
+		next = due < 0 ? 0 : due;
+	}
+	if (l->waking) {
+		int32_t due = (int32_t)(l->wakeTime - now);
+		uint32_t wake = due < 0 ? 0 : due;
+		if (wake < next) {
+			next = wake;
+		}
+	}
+	return next;
+}
+
+void VescEventLoop::poll(link * l) {
+	if (l->onPoll != NULL) {
+		l->onPoll(*l->vesc, l->context);
+	} else {
+		l->vesc->requestVescValues();
+	}
+}
+
+void VescEventLoop::watchWritable(link * l) {
+
+	// Only ask for EPOLLOUT while bytes are queued, else epoll_wait would return at once
+	bool writing = l->stream->pending() > 0;
+	if (writing == l->writing) {
+		return;
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN | (writing ? (uint32_t)EPOLLOUT : 0);
+	event.data.ptr = l->vesc;
+	if (epoll_ctl(epollFd, EPOLL_CTL_MOD, l->stream->fd(), &event) == 0) {
+		l->writing = writing;
+	}
+}
+
+#endif
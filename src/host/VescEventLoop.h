@@ -0,0 +1,101 @@
+/*
+	Single-threaded epoll loop for the Linux host build. Every link is a VescUart on a
+	non-blocking FdStream; the loop reads the descriptors that are ready, runs the parser
+	of their link, flushes transmit queues when the fd accepts more and fires the periodic
+	poll of each link. Nothing in it waits on a single VESC.
+*/
+
+#ifndef _VESCEVENTLOOP_h
+#define _VESCEVENTLOOP_h
+
+#include <VescUart.h>
+#include "FdStream.h"
+
+/** Maximum number of links one loop drives */
+#ifndef VESCEVENTLOOP_MAX_LINKS
+#define VESCEVENTLOOP_MAX_LINKS 64
+#endif
+
+class VescEventLoop
+{
+	public:
+
+		/** Called for a link, with the context given to addLink() */
+		typedef void (*linkCallback)(VescUart & vesc, void * context);
+
+		VescEventLoop(void);
+		~VescEventLoop(void);
+
+		/**
+		 * @brief      Adds a link to the loop and makes stream the serial port of vesc.
+		 * @param      vesc      - The VescUart of the link
+		 * @param      stream    - The stream of the link, must stay valid until removeLink()
+		 * @param      period_ms - Interval of onPoll, 0 for none
+		 * @param      onPoll    - Called every period_ms to send requests; NULL sends requestVescValues()
+		 * @param      onUpdate  - Called after update() decoded one or more packets and at the
+		 *                         time set with wakeAt(), may be NULL
+		 * @param      context   - Passed to both callbacks
+		 * @return     True if added, false if the loop is full or epoll refused the fd
+		 */
+		bool addLink(VescUart & vesc, FdStream & stream, uint32_t period_ms, linkCallback onPoll, linkCallback onUpdate, void * context);
+
+		/**
+		 * @brief      Removes a link from the loop. Called by the loop itself on hang-up or error.
+		 * @param      vesc - The VescUart of the link
+		 * @return     True if the link was found
+		 */
+		bool removeLink(VescUart & vesc);
+
+		/**
+		 * @brief      Waits for the next event or poll deadline and handles everything that is due.
+		 * @param      timeout_ms - Longest wait if nothing is due, -1 to wait for the next deadline
+		 * @return     Number of packets decoded, -1 on error
+		 */
+		int runOnce(int timeout_ms);
+
+		/**
+		 * @brief      Calls the onUpdate callback of a link at the given time, e.g. to expire requests.
+		 *             Only the latest time set is kept; it is cleared once the callback ran.
+		 * @param      vesc  - The VescUart of the link
+		 * @param      at_ms - The millis() time
+		 */
+		void wakeAt(VescUart & vesc, uint32_t at_ms);
+
+		/** @brief Runs until stop() is called, e.g. from a callback or a signal handler */
+		void run(void);
+
+		void stop(void);
+
+		/** @return Number of links in the loop */
+		int linkCount(void);
+
+		/** Number of links removed after a hang-up or read error */
+		uint32_t linkErrors = 0;
+
+	private:
+
+		struct link {
+			VescUart * vesc;
+			FdStream * stream;
+			uint32_t period_ms;
+			uint32_t nextPoll;
+			linkCallback onPoll;
+			linkCallback onUpdate;
+			void * context;
+			bool writing;	// EPOLLOUT is registered
+			bool waking;	// wakeAt() is pending
+			uint32_t wakeTime;
+		};
+
+		link links[VESCEVENTLOOP_MAX_LINKS];
+		int count = 0;
+		int epollFd;
+		volatile bool running = false;
+
+		uint32_t nearestDeadline(link * l, uint32_t now);
+		void poll(link * l);
+		void watchWritable(link * l);
+		void remove(int i);
+};
+
+#endif
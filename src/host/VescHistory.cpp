@@ -0,0 +1,231 @@
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "VescHistory.h"
+#include <algorithm>
+#include <stdlib.h>
+
+// Four floats: an SSE or NEON register. Two of them are used at a time so that consecutive
+// adds do not wait for each other.
+typedef float vfloat __attribute__((vector_size(16)));
+
+#define LANES 4
+
+static vfloat load(const float * p) {
+	vfloat v;
+	memcpy(&v, p, sizeof(v)); // Windows start anywhere in the column
+	return v;
+}
+
+static float sumSpan(const float * p, uint32_t n) {
+
+	vfloat a = {}, b = {};
+	uint32_t i = 0;
+	for (; i + 2 * LANES <= n; i += 2 * LANES) {
+		a += load(p + i);
+		b += load(p + i + LANES);
+	}
+	a += b;
+
+	float sum = 0;
+	for (int j = 0; j < LANES; j++) {
+		sum += a[j];
+	}
+	for (; i < n; i++) {
+		sum += p[i];
+	}
+	return sum;
+}
+
+static float minSpan(const float * p, uint32_t n, float result) {
+
+	uint32_t i = 0;
+	if (n >= 2 * LANES) {
+		vfloat a = load(p), b = load(p + LANES);
+		for (i = 2 * LANES; i + 2 * LANES <= n; i += 2 * LANES) {
+			vfloat u = load(p + i), v = load(p + i + LANES);
+			a = u < a ? u : a;
+			b = v < b ? v : b;
+		}
+		a = b < a ? b : a;
+		for (int j = 0; j < LANES; j++) {
+			result = a[j] < result ? a[j] : result;
+		}
+	}
+	for (; i < n; i++) {
+		result = p[i] < result ? p[i] : result;
+	}
+	return result;
+}
+
+static float maxSpan(const float * p, uint32_t n, float result) {
+
+	uint32_t i = 0;
+	if (n >= 2 * LANES) {
+		vfloat a = load(p), b = load(p + LANES);
+		for (i = 2 * LANES; i + 2 * LANES <= n; i += 2 * LANES) {
+			vfloat u = load(p + i), v = load(p + i + LANES);
+			a = u > a ? u : a;
+			b = v > b ? v : b;
+		}
+		a = b > a ? b : a;
+		for (int j = 0; j < LANES; j++) {
+			result = a[j] > result ? a[j] : result;
+		}
+	}
+	for (; i < n; i++) {
+		result = p[i] > result ? p[i] : result;
+	}
+	return result;
+}
+
+VescHistory::VescHistory(uint32_t capacity) {
+
+	uint32_t size = 16;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	mask = size - 1;
+
+	// Columns on cache line boundaries; every column is a multiple of 16 floats long
+	void * block = NULL;
+	if (posix_memalign(&block, 64, (size_t)size * ((HISTORY_FIELD_COUNT + 1) * sizeof(float) + sizeof(uint32_t))) != 0) {
+		columns = NULL; // addSample() then keeps nothing
+		scratch = NULL;
+		times = NULL;
+		return;
+	}
+	columns = (float *)block;
+	scratch = columns + (size_t)HISTORY_FIELD_COUNT * size;
+	times = (uint32_t *)(scratch + size);
+}
+
+VescHistory::~VescHistory(void) {
+	free(columns);
+}
+
+void VescHistory::addSample(const VescUart::dataPackage & values) {
+
+	if (columns == NULL) {
+		return;
+	}
+
+	column(HISTORY_MOTOR_CURRENT)[head]			= values.avgMotorCurrent;
+	column(HISTORY_INPUT_CURRENT)[head]			= values.avgInputCurrent;
+	column(HISTORY_DUTY)[head]					= values.dutyCycleNow;
+	column(HISTORY_RPM)[head]					= values.rpm;
+	column(HISTORY_VOLTAGE)[head]				= values.inpVoltage;
+	column(HISTORY_AMP_HOURS)[head]				= values.ampHours;
+	column(HISTORY_AMP_HOURS_CHARGED)[head]		= values.ampHoursCharged;
+	column(HISTORY_WATT_HOURS)[head]			= values.wattHours;
+	column(HISTORY_WATT_HOURS_CHARGED)[head]	= values.wattHoursCharged;
+	column(HISTORY_TEMP_MOSFET)[head]			= values.tempMosfet;
+	column(HISTORY_TEMP_MOTOR)[head]			= values.tempMotor;
+	column(HISTORY_PID_POS)[head]				= values.pidPos;
+	times[head] = values.rxTime_us;
+
+	head = (head + 1) & mask;
+	if (count <= mask) {
+		count++;
+	}
+}
+
+void VescHistory::clear(void) {
+	head = 0;
+	count = 0;
+}
+
+float VescHistory::get(field f, uint32_t age) {
+	return age < count ? column(f)[(head - 1 - age) & mask] : 0;
+}
+
+uint32_t VescHistory::time_us(uint32_t age) {
+	return age < count ? times[(head - 1 - age) & mask] : 0;
+}
+
+uint32_t VescHistory::window(uint32_t duration_us) {
+
+	if (count == 0) {
+		return 0;
+	}
+
+	// The age of a sample relative to the newest grows with its index, so binary search for
+	// the oldest one that is still within the duration
+	uint32_t newest = time_us(0);
+	uint32_t low = 0;
+	uint32_t high = count;
+	while (low + 1 < high) {
+		uint32_t middle = (low + high) / 2;
+		if (newest - time_us(middle) <= duration_us) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	return low + 1;
+}
+
+uint32_t VescHistory::spans(uint32_t n, uint32_t * start, uint32_t * first, uint32_t * second) {
+
+	n = n < count ? n : count;
+	*start = (head - n) & mask;
+	*first = n < mask + 1 - *start ? n : mask + 1 - *start;
+	*second = n - *first;
+	return n;
+}
+
+float VescHistory::mean(field f, uint32_t n) {
+
+	uint32_t start, first, second;
+	if ((n = spans(n, &start, &first, &second)) == 0) {
+		return 0;
+	}
+	const float * c = column(f);
+	return (sumSpan(c + start, first) + sumSpan(c, second)) / n;
+}
+
+float VescHistory::minimum(field f, uint32_t n) {
+
+	uint32_t start, first, second;
+	if (spans(n, &start, &first, &second) == 0) {
+		return 0;
+	}
+	const float * c = column(f);
+	return minSpan(c, second, minSpan(c + start, first, c[start]));
+}
+
+float VescHistory::maximum(field f, uint32_t n) {
+
+	uint32_t start, first, second;
+	if (spans(n, &start, &first, &second) == 0) {
+		return 0;
+	}
+	const float * c = column(f);
+	return maxSpan(c, second, maxSpan(c + start, first, c[start]));
+}
+
+float VescHistory::percentile(field f, uint32_t n, float p) {
+
+	uint32_t start, first, second;
+	if ((n = spans(n, &start, &first, &second)) == 0) {
+		return 0;
+	}
+	const float * c = column(f);
+	memcpy(scratch, c + start, first * sizeof(float));
+	memcpy(scratch + first, c, second * sizeof(float));
+
+	// Selection instead of a sort: linear time. The next rank is the smallest value above it.
+	p = p < 0 ? 0 : (p > 1 ? 1 : p);
+	float position = p * (n - 1);
+	uint32_t rank = (uint32_t)position;
+	std::nth_element(scratch, scratch + rank, scratch + n);
+
+	float value = scratch[rank];
+	float fraction = position - rank;
+	if (fraction > 0 && rank + 1 < n) {
+		float next = minSpan(scratch + rank + 1, n - rank - 1, scratch[rank + 1]);
+		value += (next - value) * fraction;
+	}
+	return value;
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+	History of the decoded telemetry of one controller for the Linux host build. Each field
+	has its own ring of floats (structure of arrays), so a window query reads one contiguous
+	column, split in two at most where the ring wraps, and the reductions run on SIMD
+	vectors instead of striding through whole samples.
+*/
+
+#ifndef _VESCHISTORY_h
+#define _VESCHISTORY_h
+
+#include <VescUart.h>
+
+class VescHistory
+{
+	public:
+
+		/** The fields kept. The tachometers are left out, floats cannot hold them exactly. */
+		enum field {
+			HISTORY_MOTOR_CURRENT,		// A
+			HISTORY_INPUT_CURRENT,		// A
+			HISTORY_DUTY,				// 0 - 1
+			HISTORY_RPM,				// ERPM
+			HISTORY_VOLTAGE,			// V
+			HISTORY_AMP_HOURS,			// Ah
+			HISTORY_AMP_HOURS_CHARGED,
+			HISTORY_WATT_HOURS,			// Wh
+			HISTORY_WATT_HOURS_CHARGED,
+			HISTORY_TEMP_MOSFET,		// degC
+			HISTORY_TEMP_MOTOR,			// degC
+			HISTORY_PID_POS,			// deg
+			HISTORY_FIELD_COUNT
+		};
+
+		/**
+		 * @brief      Class constructor
+		 * @param      capacity  - Samples kept, rounded up to a power of two of at least 16
+		 */
+		VescHistory(uint32_t capacity);
+		~VescHistory(void);
+
+		VescHistory(const VescHistory &) = delete;
+		VescHistory & operator=(const VescHistory &) = delete;
+
+		/**
+		 * @brief      Appends a sample, overwriting the oldest once full
+		 * @param      values  - The decoded values, e.g. VescUart::data. Its rxTime_us is the time of the sample.
+		 */
+		void addSample(const VescUart::dataPackage & values);
+
+		/**
+		 * @brief      Removes all samples
+		 */
+		void clear(void);
+
+		/** @return Number of samples held */
+		uint32_t size(void) { return count; }
+
+		/** @return Number of samples that fit */
+		uint32_t capacity(void) { return mask + 1; }
+
+		/**
+		 * @brief      A single value
+		 * @param      f    - The field
+		 * @param      age  - 0 for the newest sample, size() - 1 for the oldest
+		 * @return     The value, 0 if there is no such sample
+		 */
+		float get(field f, uint32_t age);
+		uint32_t time_us(uint32_t age);
+
+		/**
+		 * @brief      Number of samples received in the last duration_us before the newest one,
+		 *             to use as the window of the queries below
+		 * @param      duration_us  - Length of the window
+		 */
+		uint32_t window(uint32_t duration_us);
+
+		/**
+		 * @brief      Statistics over the newest n samples
+		 * @param      f  - The field
+		 * @param      n  - Samples in the window, limited to size()
+		 * @param      p  - Percentile, between 0 and 1; interpolated between the closest ranks
+		 * @return     0 if the window is empty
+		 */
+		float mean(field f, uint32_t n);
+		float minimum(field f, uint32_t n);
+		float maximum(field f, uint32_t n);
+		float percentile(field f, uint32_t n, float p);
+
+	private:
+
+		/** One allocation: the field columns, the times and scratch space for percentile() */
+		float * columns;
+		uint32_t * times;
+		float * scratch;
+
+		uint32_t mask;
+		uint32_t head = 0;	// Next slot to write
+		uint32_t count = 0;
+
+		float * column(field f) { return columns + (size_t)f * (mask + 1); }
+
+		/**
+		 * @brief      Splits the window of the newest n samples into the parts before and after the
+		 *             wrap of the ring
+		 * @return     Number of samples in the window
+		 */
+		uint32_t spans(uint32_t n, uint32_t * start, uint32_t * first, uint32_t * second);
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "lzo1x.h"
+#include <string.h>
+
+// Instructions used, see the LZO1X decompressor for the full format:
+//   M2 match, length 3-8, distance <= 2048:    LLLDDDSS DDDDDDDD
+//   M3 match, length >= 3, distance <= 16384:  001LLLLL [length extension] DDDDDDSS DDDDDDDD
+//   Literal run after a match with SS == 0:    0000LLLL [length extension] literals
+// SS holds the length (1-3) of a short literal run that follows the match.
+
+#define M2_MAX_LEN		8
+#define M2_MAX_OFFSET	2048
+#define M3_MAX_LEN		33
+#define M3_MAX_OFFSET	16384
+#define MIN_MATCH		4
+
+static uint32_t read32(const uint8_t *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *store_run(uint8_t *op, uint8_t *out, uint8_t *out_end, const uint8_t *lit, uint32_t t) {
+	if (op == out && t <= 238) {
+		if (op + 1 + t > out_end) {
+			return 0;
+		}
+		*op++ = 17 + t;
+	} else if (t <= 3) {
+		if (op + t > out_end) {
+			return 0;
+		}
+		op[-2] |= t;
+	} else if (t <= 18) {
+		if (op + 1 + t > out_end) {
+			return 0;
+		}
+		*op++ = t - 3;
+	} else {
+		uint32_t tt = t - 18;
+		if (op + 2 + tt / 255 + t > out_end) {
+			return 0;
+		}
+		*op++ = 0;
+		while (tt > 255) {
+			tt -= 255;
+			*op++ = 0;
+		}
+		*op++ = tt;
+	}
+
+	memcpy(op, lit, t);
+	return op + t;
+}
+
+static uint8_t *store_match(uint8_t *op, uint8_t *out_end, uint32_t dist, uint32_t len) {
+	uint32_t d = dist - 1;
+
+	if (len <= M2_MAX_LEN && dist <= M2_MAX_OFFSET) {
+		if (op + 2 > out_end) {
+			return 0;
+		}
+		*op++ = ((len - 1) << 5) | ((d & 7) << 2);
+		*op++ = d >> 3;
+		return op;
+	}
+
+	if (len <= M3_MAX_LEN) {
+		if (op + 3 > out_end) {
+			return 0;
+		}
+		*op++ = 32 | (len - 2);
+	} else {
+		uint32_t rem = len - M3_MAX_LEN;
+		if (op + 4 + rem / 255 > out_end) {
+			return 0;
+		}
+		*op++ = 32;
+		while (rem > 255) {
+			rem -= 255;
+			*op++ = 0;
+		}
+		*op++ = rem;
+	}
+	*op++ = (d << 2) & 0xFF;
+	*op++ = d >> 6;
+	return op;
+}
+
+int32_t lzo1x_1_compress(const uint8_t *in, uint16_t in_len, uint8_t *out, uint16_t out_max, uint16_t *wrkmem) {
+	uint8_t *op = out;
+	uint8_t *out_end = out + out_max;
+	uint32_t ip = 0;
+	uint32_t lit = 0;
+
+	// Positions are stored + 1, so 0 means empty
+	memset(wrkmem, 0, LZO1X_WRKMEM_SIZE * sizeof(uint16_t));
+
+	while (ip + MIN_MATCH <= in_len) {
+		uint32_t v = read32(in + ip);
+		uint32_t h = (uint32_t)(v * 0x1824429DUL) >> (32 - LZO1X_HASH_BITS);
+		uint32_t cand = wrkmem[h];
+		wrkmem[h] = ip + 1;
+
+		if (cand == 0 || ip - (cand - 1) > M3_MAX_OFFSET || read32(in + cand - 1) != v) {
+			ip++;
+			continue;
+		}
+		cand--;
+
+		uint32_t len = MIN_MATCH;
+		while (ip + len < in_len && in[cand + len] == in[ip + len]) {
+			len++;
+		}
+
+		if (ip > lit) {
+			op = store_run(op, out, out_end, in + lit, ip - lit);
+			if (op == 0) {
+				return -1;
+			}
+		}
+
+		op = store_match(op, out_end, ip - cand, len);
+		if (op == 0) {
+			return -1;
+		}
+
+		ip += len;
+		lit = ip;
+	}
+
+	if (in_len > lit) {
+		op = store_run(op, out, out_end, in + lit, in_len - lit);
+		if (op == 0) {
+			return -1;
+		}
+	}
+
+	// End of stream: M4 match with distance 0
+	if (op + 3 > out_end) {
+		return -1;
+	}
+	*op++ = 16 | 1;
+	*op++ = 0;
+	*op++ = 0;
+
+	return op - out;
+}
@@ -0,0 +1,23 @@
+#ifndef LZO1X_H_
+#define LZO1X_H_
+
+#include <stdint.h>
+
+// Constants
+#ifndef LZO1X_HASH_BITS
+#define LZO1X_HASH_BITS		10
+#endif
+#define LZO1X_WRKMEM_SIZE	(1 << LZO1X_HASH_BITS)	// Entries of uint16_t
+
+// Functions
+
+/*
+ * LZO1X-1 compatible compressor for small blocks, decompressed by lzo1x_decompress_safe
+ * on the VESC. Matches are limited to a distance of 16 kB, so in_len should stay below that
+ * for the best result. wrkmem must hold LZO1X_WRKMEM_SIZE entries.
+ *
+ * Returns the compressed length, or -1 if it would exceed out_max.
+ */
+int32_t lzo1x_1_compress(const uint8_t *in, uint16_t in_len, uint8_t *out, uint16_t out_max, uint16_t *wrkmem);
+
+#endif /* LZO1X_H_ */